@@ -0,0 +1,551 @@
+/*
+ * perfbench - end-to-end startup benchmark for fetcha
+ *
+ * runs the given command N times cold (page cache dropped where permitted)
+ * and N times warm, on a pty so the command sees a real terminal (that
+ * answers DA1), and collects per run:
+ * - wall time and rusage (user/sys time, max rss)
+ * - instructions, page faults, context switches, task clock
+ *   through perf_event_open (inherited by children)
+ * one extra run is traced with ptrace to count syscalls and spawned
+ * children/threads, exactly.
+ *
+ * medians are written as JSON and optionally compared with a baseline,
+ * exit status is 1 if any gated metric regressed more than the threshold.
+ *
+ * usage: perfbench [-n runs] [-t threshold%] [-o out.json]
+ *                  [-b baseline.json] cmd [args...]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NA (-1.0) /* metric not available */
+
+enum {
+  M_WALL_US,
+  M_USER_US,
+  M_SYS_US,
+  M_MAXRSS_KB,
+  M_TASK_CLOCK_US,
+  M_INSTRUCTIONS,
+  M_PAGE_FAULTS,
+  M_CTX_SWITCHES,
+  M_COUNT,
+};
+
+static const char *metric_names[M_COUNT] = {
+  "wall_us", "user_us", "sys_us", "maxrss_kb",
+  "task_clock_us", "instructions", "page_faults", "ctx_switches",
+};
+
+/* rusage split and rss are too coarse to be gated, they're only reported */
+static const bool metric_gated[M_COUNT] = {
+  true, false, false, false, true, true, true, true,
+};
+
+static const bool trace_gated[] = { true, true, true, true };
+
+/* perf events, in metric order, starting at M_TASK_CLOCK_US */
+static const struct { uint32_t type; uint64_t config; } perf_events[] = {
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+#define PERF_EVENTS (sizeof perf_events / sizeof perf_events[0])
+
+enum { T_SYSCALLS, T_CHILDREN, T_THREADS, T_EXECS, T_COUNT };
+
+static const char *trace_names[T_COUNT] = {
+  "syscalls", "children", "threads", "execs",
+};
+
+static char **cmd;
+
+static void
+die(const char *msg)
+{
+  perror(msg);
+  exit(2);
+}
+
+static double
+now_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/*
+ * function that drops page cache,
+ * returns false if not permitted (not root, read-only /proc)
+ */
+static bool
+drop_caches(void)
+{
+  int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+  if (fd < 0) return false;
+  sync();
+  bool ok = write(fd, "3", 1) == 1;
+  close(fd);
+  return ok;
+}
+
+/*
+ * function that opens pty master, with slave sized like a usual terminal
+ */
+static int
+open_pty(char **slave)
+{
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+    die("posix_openpt");
+  *slave = ptsname(master);
+  fcntl(master, F_SETFL, O_NONBLOCK);
+  return master;
+}
+
+/*
+ * function that reads what command printed, and answers DA1 query
+ * (CSI c) like a terminal does, so terminal queries don't time out
+ */
+static void
+drain(int master)
+{
+  static const char da1[] = "\x1b[?62;22c";
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(master, buf, sizeof buf)) > 0)
+    for (ssize_t i = 0; i + 2 < n; i++)
+      if (!memcmp(buf + i, "\x1b[c", 3) &&
+          write(master, da1, sizeof da1 - 1) < 0)
+        break;
+}
+
+/*
+ * function that forks child, which waits for go byte on sync pipe
+ * and then execs cmd with stdout/stderr on pty slave
+ */
+static pid_t
+spawn(const char *slave, int sync_fd[2], bool traced)
+{
+  pid_t pid = fork();
+  if (pid < 0) die("fork");
+  if (pid > 0) return pid;
+
+  setsid();
+  int fd = open(slave, O_RDWR);
+  if (fd < 0) _exit(127);
+  struct winsize ws = { .ws_row = 40, .ws_col = 120 };
+  ioctl(fd, TIOCSWINSZ, &ws);
+  dup2(fd, STDOUT_FILENO);
+  dup2(fd, STDERR_FILENO);
+  if (fd > STDERR_FILENO) close(fd);
+
+  close(sync_fd[1]);
+  char c;
+  if (read(sync_fd[0], &c, 1) != 1) _exit(127);
+  close(sync_fd[0]);
+
+  if (traced) {
+    ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+    raise(SIGSTOP);
+  }
+  execvp(cmd[0], cmd);
+  _exit(127);
+}
+
+static int
+perf_open(pid_t pid, uint32_t type, uint64_t config)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof attr);
+  attr.size = sizeof attr;
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.enable_on_exec = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 0;
+  return syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+/*
+ * function that runs cmd once and fills metrics m[]
+ */
+static void
+run_once(double m[M_COUNT])
+{
+  int sync_fd[2];
+  char *slave;
+  int master = open_pty(&slave);
+  int perf_fd[PERF_EVENTS];
+
+  if (pipe(sync_fd) < 0) die("pipe");
+  pid_t pid = spawn(slave, sync_fd, false);
+  close(sync_fd[0]);
+
+  for (size_t i = 0; i < PERF_EVENTS; i++)
+    perf_fd[i] = perf_open(pid, perf_events[i].type, perf_events[i].config);
+
+  double start = now_us();
+  if (write(sync_fd[1], "g", 1) != 1) die("write");
+  close(sync_fd[1]);
+
+  int status;
+  struct rusage ru;
+  while (wait4(pid, &status, WNOHANG, &ru) == 0) {
+    struct pollfd pfd = { .fd = master, .events = POLLIN };
+    poll(&pfd, 1, 1);
+    drain(master);
+  }
+  m[M_WALL_US] = now_us() - start;
+  drain(master);
+  close(master);
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    fprintf(stderr, "perfbench: %s exited with status %d\n", cmd[0], status);
+
+  m[M_USER_US] = ru.ru_utime.tv_sec * 1e6 + ru.ru_utime.tv_usec;
+  m[M_SYS_US] = ru.ru_stime.tv_sec * 1e6 + ru.ru_stime.tv_usec;
+  m[M_MAXRSS_KB] = ru.ru_maxrss;
+
+  for (size_t i = 0; i < PERF_EVENTS; i++) {
+    uint64_t v;
+    double *dst = &m[M_TASK_CLOCK_US + i];
+    *dst = NA;
+    if (perf_fd[i] < 0) continue;
+    if (read(perf_fd[i], &v, sizeof v) == sizeof v)
+      *dst = (i == 0) ? v / 1e3 : (double)v; /* task clock is in ns */
+    close(perf_fd[i]);
+  }
+
+  /* rusage fallbacks (own process excluded, children only) */
+  if (m[M_PAGE_FAULTS] == NA)
+    m[M_PAGE_FAULTS] = ru.ru_minflt + ru.ru_majflt;
+  if (m[M_CTX_SWITCHES] == NA)
+    m[M_CTX_SWITCHES] = ru.ru_nvcsw + ru.ru_nivcsw;
+}
+
+/* threads that are currently inside of syscall */
+#define MAX_TRACEES 1024
+static pid_t in_syscall[MAX_TRACEES];
+
+static bool
+toggle_syscall(pid_t tid)
+{
+  for (int i = 0; i < MAX_TRACEES; i++) {
+    if (in_syscall[i] == tid) {
+      in_syscall[i] = 0;
+      return false;
+    }
+  }
+  for (int i = 0; i < MAX_TRACEES; i++) {
+    if (in_syscall[i] == 0) {
+      in_syscall[i] = tid;
+      break;
+    }
+  }
+  return true;
+}
+
+static bool
+is_thread(pid_t tid)
+{
+  char path[64], line[128];
+  pid_t tgid = tid;
+  snprintf(path, sizeof path, "/proc/%d/status", tid);
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  while (fgets(line, sizeof line, f))
+    if (sscanf(line, "Tgid: %d", &tgid) == 1) break;
+  fclose(f);
+  return tgid != tid;
+}
+
+/*
+ * function that runs cmd under ptrace, counting syscall entries,
+ * spawned processes, threads and execs in all descendants,
+ * returns false if ptrace isn't permitted
+ */
+static bool
+run_traced(double t[T_COUNT])
+{
+  int sync_fd[2];
+  char *slave;
+  int master = open_pty(&slave);
+
+  for (int i = 0; i < T_COUNT; i++) t[i] = 0;
+  memset(in_syscall, 0, sizeof in_syscall);
+
+  if (pipe(sync_fd) < 0) die("pipe");
+  pid_t pid = spawn(slave, sync_fd, true);
+  close(sync_fd[0]);
+  if (write(sync_fd[1], "g", 1) != 1) die("write");
+  close(sync_fd[1]);
+
+  int status;
+  if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status)) {
+    close(master);
+    return false;
+  }
+  long opts = PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEFORK |
+              PTRACE_O_TRACEVFORK | PTRACE_O_TRACECLONE |
+              PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL;
+  if (ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)opts) < 0) {
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    close(master);
+    return false;
+  }
+  ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+
+  int alive = 1;
+  while (alive > 0) {
+    pid_t tid = waitpid(-1, &status, __WALL);
+    if (tid < 0) break;
+    drain(master);
+
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+      alive--;
+      continue;
+    }
+
+    int sig = 0;
+    int event = status >> 16;
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+      if (toggle_syscall(tid)) t[T_SYSCALLS]++;
+    } else if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK ||
+               event == PTRACE_EVENT_CLONE) {
+      unsigned long child;
+      ptrace(PTRACE_GETEVENTMSG, tid, NULL, &child);
+      t[is_thread(child) ? T_THREADS : T_CHILDREN]++;
+      alive++;
+    } else if (event == PTRACE_EVENT_EXEC) {
+      t[T_EXECS]++;
+    } else if (event == 0 && WSTOPSIG(status) != SIGSTOP &&
+               WSTOPSIG(status) != SIGTRAP) {
+      sig = WSTOPSIG(status);
+    }
+    ptrace(PTRACE_SYSCALL, tid, NULL, (void *)(long)sig);
+  }
+  /* first exec is our own execvp of cmd */
+  if (t[T_EXECS] > 0) t[T_EXECS]--;
+  close(master);
+  return true;
+}
+
+static int
+cmp_double(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * function that reduces runs[n][M_COUNT] to medians
+ */
+static void
+median(double (*runs)[M_COUNT], int n, double out[M_COUNT])
+{
+  double *col = malloc(n * sizeof *col);
+  if (!col) die("malloc");
+  for (int m = 0; m < M_COUNT; m++) {
+    int k = 0;
+    for (int i = 0; i < n; i++)
+      if (runs[i][m] != NA) col[k++] = runs[i][m];
+    if (k == 0) {
+      out[m] = NA;
+      continue;
+    }
+    qsort(col, k, sizeof *col, cmp_double);
+    out[m] = (k % 2) ? col[k / 2] : (col[k / 2 - 1] + col[k / 2]) / 2;
+  }
+  free(col);
+}
+
+static void
+json_section(FILE *f, const char *name, const char **names, double *v,
+             int n, bool last)
+{
+  fprintf(f, "  \"%s\": {\n", name);
+  for (int i = 0; i < n; i++) {
+    if (v[i] == NA)
+      fprintf(f, "    \"%s\": null", names[i]);
+    else
+      fprintf(f, "    \"%s\": %.0f", names[i], v[i]);
+    fprintf(f, "%s\n", i + 1 < n ? "," : "");
+  }
+  fprintf(f, "  }%s\n", last ? "" : ",");
+}
+
+/*
+ * function that finds "key" inside of "section": {...} in json text,
+ * enough for files written by json_section()
+ * returns NA if not found or null
+ */
+static double
+json_get(const char *json, const char *section, const char *key)
+{
+  char pat[64];
+  snprintf(pat, sizeof pat, "\"%s\"", section);
+  const char *s = strstr(json, pat);
+  if (!s) return NA;
+  const char *end = strchr(s, '}');
+  snprintf(pat, sizeof pat, "\"%s\":", key);
+  const char *k = strstr(s, pat);
+  if (!k || (end && k > end)) return NA;
+  k += strlen(pat);
+  while (*k == ' ') k++;
+  if (strncmp(k, "null", 4) == 0) return NA;
+  return strtod(k, NULL);
+}
+
+static char *
+slurp(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  if (!f) return NULL;
+  char *buf = NULL;
+  size_t len = 0, n;
+  char chunk[4096];
+  while ((n = fread(chunk, 1, sizeof chunk, f)) > 0) {
+    char *tmp = realloc(buf, len + n + 1);
+    if (!tmp) die("realloc");
+    buf = tmp;
+    memcpy(buf + len, chunk, n);
+    len += n;
+  }
+  fclose(f);
+  if (buf) buf[len] = '\0';
+  return buf;
+}
+
+/*
+ * function that prints comparison with baseline,
+ * returns number of regressed metrics
+ */
+static int
+compare(const char *base, const char *section, const char **names,
+        const bool *gated, double *v, int n, double threshold)
+{
+  int regressions = 0;
+  for (int i = 0; i < n; i++) {
+    double b = json_get(base, section, names[i]);
+    if (b == NA || v[i] == NA) continue;
+    double delta = b > 0 ? (v[i] - b) * 100.0 / b : (v[i] > 0 ? 100.0 : 0);
+    bool bad = gated[i] && delta > threshold;
+    printf("%-5s %-14s %14.0f %14.0f %+8.1f%%%s\n", section, names[i], b,
+           v[i], delta, bad ? "  REGRESSION" : "");
+    regressions += bad;
+  }
+  return regressions;
+}
+
+static void
+usage(void)
+{
+  fputs("usage: perfbench [-n runs] [-t threshold%] [-o out.json] "
+        "[-b baseline.json] cmd [args...]\n", stderr);
+  exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int runs = 20;
+  double threshold = 10;
+  const char *out_path = NULL;
+  const char *base_path = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "+n:t:o:b:")) != -1) {
+    switch (opt) {
+    case 'n': runs = atoi(optarg); break;
+    case 't': threshold = atof(optarg); break;
+    case 'o': out_path = optarg; break;
+    case 'b': base_path = optarg; break;
+    default:  usage();
+    }
+  }
+  if (optind >= argc || runs < 1) usage();
+  cmd = argv + optind;
+
+  double (*cold)[M_COUNT] = calloc(runs, sizeof *cold);
+  double (*warm)[M_COUNT] = calloc(runs, sizeof *warm);
+  if (!cold || !warm) die("calloc");
+
+  bool dropped = true;
+  for (int i = 0; i < runs; i++) {
+    dropped &= drop_caches();
+    run_once(cold[i]);
+  }
+  run_once(warm[0]); /* prime the cache */
+  for (int i = 0; i < runs; i++)
+    run_once(warm[i]);
+
+  double cold_med[M_COUNT], warm_med[M_COUNT], trace[T_COUNT];
+  median(cold, runs, cold_med);
+  median(warm, runs, warm_med);
+  bool traced = run_traced(trace);
+  if (!traced)
+    for (int i = 0; i < T_COUNT; i++) trace[i] = NA;
+
+  FILE *out = out_path ? fopen(out_path, "w") : stdout;
+  if (!out) die(out_path);
+  fprintf(out, "{\n  \"runs\": %d,\n  \"cold_dropped\": %s,\n",
+          runs, dropped ? "true" : "false");
+  json_section(out, "cold", metric_names, cold_med, M_COUNT, false);
+  json_section(out, "warm", metric_names, warm_med, M_COUNT, false);
+  json_section(out, "trace", trace_names, trace, T_COUNT, true);
+  fprintf(out, "}\n");
+  if (out != stdout) fclose(out);
+
+  if (!dropped)
+    fputs("perfbench: can't drop page cache, cold runs are warm\n", stderr);
+  if (!traced)
+    fputs("perfbench: ptrace not permitted, no syscall counts\n", stderr);
+
+  if (!base_path) return 0;
+  char *base = slurp(base_path);
+  if (!base) {
+    fprintf(stderr, "perfbench: no baseline %s, skipping compare\n", base_path);
+    return 0;
+  }
+
+  printf("%-5s %-14s %14s %14s %9s\n", "", "metric", "baseline", "current",
+         "delta");
+  int bad = 0;
+  /* cold numbers depend on the disk, only warm runs and traces are gated */
+  bad += compare(base, "warm", metric_names, metric_gated, warm_med,
+                 M_COUNT, threshold);
+  bad += compare(base, "trace", trace_names, trace_gated, trace,
+                 T_COUNT, threshold);
+  free(base);
+
+  if (bad) {
+    printf("perfbench: %d metric(s) regressed more than %.0f%%\n", bad,
+           threshold);
+    return 1;
+  }
+  return 0;
+}
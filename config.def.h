@@ -1,7 +1,11 @@
 #include "modules.h"
+#include "image.h"
 #include <stdio.h>
 
 
+static const int  layout               = LAYOUT_ART_LEFT; /* where art is:
+                                         LAYOUT_ART_LEFT, LAYOUT_ART_RIGHT,
+                                         LAYOUT_ART_TOP, LAYOUT_ART_BOTTOM */
 static const int  ascii_pad            = 10; /* padding ascii/info */
 static const bool info_align           = true; /* align info by separator */
 static const bool header_show          = true; /* if 0 doot print header */
@@ -9,6 +13,13 @@ static const bool color_palette_show   = true;
 static const char *info_sep            = ": ";
 static const bool numerate_same        = true;
 static const bool line_break           = true;
+static const bool color_auto           = true; /* no colors if not a tty */
+static const bool info_skip_scrolled   = false; /* don't run modules, that
+                                                   scroll out of terminal */
+static const bool progressive          = false; /* print slow rows later,
+                                                   thread per module */
+static const int  progressive_wait_ms  = 5;  /* wait for rows before print */
+static const char *progressive_placeholder = "...";
 
 /* 
  * colors ANSI 
@@ -51,25 +62,126 @@ static const char line_break_char = '>';
 
 /*
  * information
- * Label, func
+ * Label, func, rows (most rows module prints, 0 - one row),
+ * flags (for fetcha --daemon):
+ *   0         - result never changes, module runs once
+ *   ITEM_LIVE - module runs for every frame
+ *   ITEM_ENV  - module runs again for other client (daemon_env, parents)
+ *   ITEM_SHARED - slow module, processes started together (tmux restoring
+ *                 session) share one result, see shared_ttl_ms,
+ *                 ITEM_ENV ones only with the same shell and terminal
+ * commented out items are optional modules
  */
 static info_item config_items[] = {
   { "OS",       get_os },
   { "HOST",     get_host },
   { "Kernel",   get_kernel },
-  { "Uptime",   get_uptime },
-  { "Memory",   get_memory },
-  { "CPU",      get_cpus },
-  { "GPU",      get_gpus },
-  { "WM",       get_wm },
-  { "Shell",    get_shell },
-  { "Editor",   get_editor },
-  { "Terminal", get_terminal },
+  { "Uptime",   get_uptime,   0, ITEM_LIVE },
+  /* { "Boot",     get_boot }, */
+  { "Memory",   get_memory,   0, ITEM_LIVE },
+  { "CPU",      get_cpus,     4 },
+  /* { "ISA",      get_isa }, */
+  /* { "Virt",     get_virt }, */
+  { "GPU",      get_gpus,     4, ITEM_SHARED },
+  /* { "GPU use",  get_gpu_stats, 4, ITEM_LIVE }, */
+  /* { "Display",  get_display,  4 }, */
+  { "WM",       get_wm,       0, ITEM_SHARED },
+  { "Shell",    get_shell,    0, ITEM_ENV | ITEM_SHARED },
+  { "Editor",   get_editor,   0, ITEM_ENV },
+  { "Terminal", get_terminal, 0, ITEM_ENV },
+  /* { "Load",     get_cpu_load, 0, ITEM_LIVE }, sleeps on first run */
+  /* { "Users",    get_users,    0, ITEM_LIVE }, */
+  /* { "Processes", get_processes, 0, ITEM_LIVE }, */
 
 };
 
 const size_t config_items_len = sizeof config_items / sizeof config_items[0];
 
+/*
+ * module options
+ */
+const bool cpu_load_psi       = true;  /* add /proc/pressure avg10 */
+const bool cpu_load_numa      = false; /* row per NUMA node, raise rows
+                                          of Load in config_items */
+const bool cpu_load_percore   = false; /* row per core, raise rows too */
+const int  cpu_load_sample_ms = 50;    /* sleep if there is no sample */
+const int  cpu_load_max_age   = 600;   /* older samples are unusable (s) */
+const bool container_view     = true;  /* get_cpus, get_memory: limits of
+                                          cgroup v2, if there are any */
+const bool memory_detail      = false; /* get_memory: row of available,
+                                          swap, zram and huge pages, raise
+                                          rows of Memory in config_items */
+const int  memory_top         = 0;     /* get_memory: rows of processes
+                                          using most memory (at most 32),
+                                          raise rows of Memory too */
+const int  memory_top_threads = 4;     /* threads reading their statm */
+const bool display_ioctl      = true;  /* active mode and refresh rate
+                                          from /dev/dri, else preferred mode */
+const int  gpu_stats_ms       = 20;    /* get_gpu_stats: time for
+                                          attributes of one GPU */
+const bool terminal_query     = true;  /* get_terminal: ask terminal
+                                          (XTVERSION), if no parent is it */
+const int  terminal_query_ms  = 10;    /* wait for answer */
+/* get_isa: extensions shown, if CPU has them (x86 and aarch64 names) */
+const char *isa_extensions[] = {
+  "avx512_vnni", "avx512_bf16", "amx_tile", "sha_ni", "vaes", "gfni",
+  "sve", "sve2", "sme", "sha3", "i8mm", "bf16", NULL
+};
+
+/*
+ * terminal widths, fetcha --render-to makes frame for,
+ * 0 - unlimited width without colors, used when output isn't a terminal
+ */
+static const int motd_widths[] = { 0, 60, 80, 100, 120, 160 };
+
+
+/*
+ * ITEM_SHARED modules
+ * shared_ttl_ms  - how long result is reused, 0 - run module in every process
+ *                  (e.g. 2000 for tmux sessions, many ssh logins, MOTD)
+ * shared_wait_ms - how long to wait for process running module,
+ *                  then run it here
+ */
+static const int shared_ttl_ms  = 0;
+static const int shared_wait_ms = 1000;
+
+/*
+ * fetcha --daemon, $XDG_RUNTIME_DIR/fetcha/sock
+ * daemon_client     - ask daemon for frame first, render it here if
+ *                     there is no daemon or it doesn't answer in time
+ * daemon_timeout_ms - how long to wait for frame
+ * daemon_env        - variables client sends, modules ITEM_ENV read them
+ */
+static const bool daemon_client     = true;
+static const int  daemon_timeout_ms = 50;
+static const char *daemon_env[] = {
+  "SHELL", "EDITOR", "TERMINAL", "TERM_PROGRAM", "TERM", NULL
+};
+
+/*
+ * fetcha --replay bundle: wait as long as every read took
+ * on the captured host (fetcha --capture bundle)
+ */
+static const bool replay_timing = true;
+
+
+/*
+ * ascii_auto - select logo from logos/ by os-release ID/ID_LIKE,
+ * ascii_art is used if there is no logo for this system
+ */
+static const bool ascii_auto  = true;
+
+/*
+ * image logo instead of ascii art, on terminal with graphics
+ * image_path     - PNG (kitty only), farbfeld or binary PPM, NULL - ascii art
+ * image_protocol - IMAGE_AUTO (kitty on kitty, WezTerm, Ghostty),
+ *                  IMAGE_KITTY, IMAGE_SIXEL or IMAGE_NONE
+ * image_width    - width in cells, height follows aspect ratio
+ * encoded image is cached in $XDG_CACHE_HOME/fetcha
+ */
+static const char *image_path     = NULL;
+static const int   image_protocol = IMAGE_AUTO;
+static const int   image_width    = 24;
 
 static const char *ascii_art  =
 "                   $1-` \n"
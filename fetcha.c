@@ -32,12 +32,35 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <pwd.h>
 #include <sys/utsname.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "modules.h"
+#include "image.h"
+#include "io.h"
+
+/* layouts of frame, where ascii art is beside info (config.h) */
+enum {
+  LAYOUT_ART_LEFT,
+  LAYOUT_ART_RIGHT,
+  LAYOUT_ART_TOP,
+  LAYOUT_ART_BOTTOM,
+};
+
 #include "config.h"
+#include "hash.h"
+#include "logos.h"
 
 #define  COLORS 10
 
@@ -48,6 +71,9 @@ struct ascii
   char *art; 
   int width;
   int height;
+  int image;        /* fd of cached image payload, -1 - text art */
+  off_t image_off;  /* payload in image file */
+  off_t image_len;
 };
 
 void
@@ -56,6 +82,8 @@ free_ascii(struct ascii *s)
   if (!s) return;
   free(s->art);
   s->art = NULL;
+  if (s->image >= 0) close(s->image);
+  s->image = -1;
 }
 
 /* header */
@@ -64,6 +92,7 @@ typedef struct
   char *name;     
   char *sep;      /* separator name[]hostname */
   char hostname[256];
+  char boundary[512];
 
 } header;
 
@@ -72,6 +101,7 @@ typedef struct
 {
   char *label;
   char *value;
+  bool pending;   /* value is placeholder, row is patched later */
 
 } rendered_info;
 
@@ -96,24 +126,157 @@ free_info_list(info_list *infos) {
 }
 
 /*
- * prints string with line break (if setted up "line_break")
- * return 0: if no line_break
- * return 1: if line_break
+ * SGR (colors/attributes) state
+ * fg, bg - ansi codes, 0 means terminal default
+ * attr   - SGR_* bitmask
  */
-int
-puts_limited(const char *s, int term_width, int *curw, bool show_break)
-{
-  while (*s) {
-    if (term_width > 0 && *curw >= term_width - 2 && line_break) {
-      if (show_break) 
-        printf(" \x1b[%dm%c", colors[9], line_break_char);
-      *curw = term_width;
-      return 1;
-    }
-    putchar(*s++);
-    (*curw)++;
+enum {
+  SGR_BOLD      = 1 << 0,
+  SGR_DIM       = 1 << 1,
+  SGR_ITALIC    = 1 << 2,
+  SGR_UNDERLINE = 1 << 3,
+  SGR_REVERSE   = 1 << 4,
+};
+
+static const int sgr_attr_codes[] = {1, 2, 3, 4, 7};
+
+struct sgr
+{
+  int fg;
+  int bg;
+  int attr;
+};
+
+static struct sgr sgr_term; /* state the terminal is in */
+static struct sgr sgr_pen;  /* state the next printed char needs */
+static bool       sgr_on = true;
+
+static FILE *out; /* where frame is printed, stdout or --render-to file */
+
+/*
+ * function that appends ";code" (or "code" if buf is empty) to buf
+ */
+static void
+sgr_append(char *buf, size_t size, int code)
+{
+  size_t len = strlen(buf);
+  snprintf(buf + len, size - len, len ? ";%d" : "%d", code);
+}
+
+/*
+ * function that emits the shortest sequence, that moves terminal
+ * from sgr_term to want:
+ * - full: reset and set everything again ("0;31")
+ * - diff: set only changed fields ("31"), only if no attr was removed
+ */
+static void
+sgr_emit(struct sgr want)
+{
+  char full[64] = "0";
+  char diff[64] = "";
+  bool diff_ok = (sgr_term.attr & ~want.attr) == 0;
+
+  if (want.fg) sgr_append(full, sizeof full, want.fg);
+  if (want.bg) sgr_append(full, sizeof full, want.bg);
+  for (size_t i = 0; i < sizeof sgr_attr_codes / sizeof sgr_attr_codes[0]; i++)
+    if (want.attr & (1 << i)) sgr_append(full, sizeof full, sgr_attr_codes[i]);
+
+  if (diff_ok) {
+    if (want.fg != sgr_term.fg)
+      sgr_append(diff, sizeof diff, want.fg ? want.fg : 39);
+    if (want.bg != sgr_term.bg)
+      sgr_append(diff, sizeof diff, want.bg ? want.bg : 49);
+    for (size_t i = 0; i < sizeof sgr_attr_codes / sizeof sgr_attr_codes[0]; i++)
+      if ((want.attr & ~sgr_term.attr) & (1 << i))
+        sgr_append(diff, sizeof diff, sgr_attr_codes[i]);
   }
-  return 0;
+
+  fprintf(out, "\x1b[%sm", (diff_ok && strlen(diff) < strlen(full)) ? diff : full);
+  sgr_term = want;
+}
+
+/*
+ * function that brings terminal to sgr_pen before printing c,
+ * blank chars (' ', '\n') don't show fg, so it isn't changed for them,
+ * '\n' also doesn't need bg, but it's reset to avoid bleeding on scroll
+ */
+static void
+sgr_sync(char c)
+{
+  struct sgr want = sgr_pen;
+
+  if (!sgr_on) return;
+
+  if ((c == ' ' || c == '\n') &&
+      !(want.attr & (SGR_UNDERLINE | SGR_REVERSE)))
+    want.fg = sgr_term.fg;
+  if (c == '\n') {
+    want.bg = 0;
+    want.attr &= ~SGR_REVERSE;
+  }
+
+  if (want.fg != sgr_term.fg || want.bg != sgr_term.bg ||
+      want.attr != sgr_term.attr)
+    sgr_emit(want);
+}
+
+void
+sgr_fg(int code)
+{
+  sgr_pen.fg = code;
+}
+
+void
+sgr_bg(int code)
+{
+  sgr_pen.bg = code;
+}
+
+void
+sgr_attr(int attr)
+{
+  sgr_pen.attr = attr;
+}
+
+void
+sgr_reset(void)
+{
+  sgr_pen = (struct sgr){0};
+}
+
+/*
+ * function that leaves terminal in default state
+ */
+void
+sgr_finish(void)
+{
+  sgr_reset();
+  if (sgr_on && (sgr_term.fg || sgr_term.bg || sgr_term.attr))
+    sgr_emit(sgr_pen);
+}
+
+/*
+ * all visible output goes here, so colors are emitted only when changed,
+ * function that prints n bytes of s (no '\n'),
+ * the first not blank char decides, if fg is needed
+ */
+void
+out_bytes(const char *s, int n)
+{
+  int i = 0;
+  while (i < n && s[i] == ' ') i++;
+  sgr_sync(i < n ? s[i] : ' ');
+  fwrite(s, 1, n, out);
+}
+
+/*
+ * function that prints n spaces
+ */
+void
+out_spaces(int n)
+{
+  sgr_sync(' ');
+  fprintf(out, "%*s", n, "");
 }
 
 /*
@@ -142,14 +305,20 @@ c_to_ansi(const char *color, char *out, size_t out_size)
 
 
 /*
- * function that:
- * 1. if (align_info) add padding to label
- * 2. return info_list, with malloc!
+ * function that returns how many rows module may print (info_item.rows)
  */
-info_list
-render_info(info_item infos[], size_t info_size)
+int
+item_rows(const info_item *item)
+{
+  return item->rows > 0 ? item->rows : 1;
+}
+
+/*
+ * function that returns length labels are padded to (if info_align)
+ */
+size_t
+label_width(info_item infos[], size_t info_size)
 {
-  info_list res = {NULL, 0};
   size_t maxlen = 0;
 
   if (info_align) {
@@ -160,53 +329,227 @@ render_info(info_item infos[], size_t info_size)
       }
     }
   }
+  return maxlen;
+}
 
-  for (size_t i = 0; i < info_size; i++) {
-    char *value = infos[i].func();
-    if (!value) value = "(null)";
-
-    /* count strings */
-    int split_count = 0;
-    {
-      char *tmp = strdup(value);
-      char  *p = strtok(tmp, "\n");
-      while (p) {
-        split_count++;
-        p = strtok(NULL, "\n");
-      }
-      free(tmp);
+/*
+ * function that adds row to res,
+ * label is padded to maxlen (if info_align), value is copied
+ */
+void
+add_row(info_list *res, const char *label, const char *value, size_t maxlen,
+        bool pending)
+{
+  rendered_info *row;
+
+  res->entries = realloc(res->entries,
+                         sizeof(rendered_info) * (res->count + 1));
+  row = &res->entries[res->count++];
+  row->label = NULL;
+  row->value = value ? strdup(value) : NULL;
+  row->pending = pending;
+  if (!label) return;
+
+  if (info_align) {
+    char padded[128];
+    snprintf(padded, sizeof(padded), "%-*s", (int)maxlen, label);
+    row->label = strdup(padded);
+  } else {
+    row->label = strdup(label);
+  }
+}
+
+/*
+ * function that splits value of module by \n to rows of res
+ * (at most item_rows()), numerates labels if numerate_same,
+ * frees value
+ */
+void
+render_value(info_list *res, const info_item *item, char *value,
+             size_t maxlen)
+{
+  int rows = item_rows(item);
+  char *save;
+
+  if (!value) value = strdup("(null)");
+
+  /* count strings */
+  int split_count = 0;
+  {
+    char *tmp = strdup(value);
+    char  *p = strtok_r(tmp, "\n", &save);
+    while (p) {
+      split_count++;
+      p = strtok_r(NULL, "\n", &save);
     }
-    
-    /* split strings by \n */
-    char *line = strtok(value, "\n");
-    int number = 1;
-    while (line) {
-      res.entries = realloc(res.entries, 
-                            sizeof(rendered_info) * (res.count + 1));
-      
-      char tmp_label[128];
-      if (split_count > 1 && numerate_same) {
-        snprintf(tmp_label, sizeof(tmp_label), "%s%d", infos[i].label, number);
-      } else {
-        snprintf(tmp_label, sizeof(tmp_label), "%s", infos[i].label);
-      }
+    free(tmp);
+  }
+  if (split_count > rows) split_count = rows;
+  
+  /* split strings by \n */
+  char *line = strtok_r(value, "\n", &save);
+  int number = 1;
+  while (line && number <= rows) {
+    char tmp_label[128];
+    if (split_count > 1 && numerate_same) {
+      snprintf(tmp_label, sizeof(tmp_label), "%s%d", item->label, number);
+    } else {
+      snprintf(tmp_label, sizeof(tmp_label), "%s", item->label);
+    }
+    add_row(res, tmp_label, line, maxlen, false);
 
+    line = strtok_r(NULL, "\n", &save);
+    number++;
+  }
+  free(value);
+}
 
-      if (info_align) {
-        char padded[128];
-        snprintf(padded, sizeof(padded), "%-*s", (int)maxlen, tmp_label);
-        res.entries[res.count].label = strdup(padded);
-      } else {
-        res.entries[res.count].label = strdup(tmp_label);
-      }
+/*
+ * function that writes daemon_env variables as "NAME=value\n" to buf
+ * returns length, -1 if they don't fit or value has \n
+ */
+int
+env_block(char *buf, size_t size)
+{
+  size_t len = 0;
+
+  buf[0] = '\0';
+  for (const char **v = daemon_env; *v; v++) {
+    const char *value = getenv(*v);
+    if (!value) continue;
+    if (strchr(value, '\n')) return -1;
+    len += snprintf(buf + len, size - len, "%s=%s\n", *v, value);
+    if (len >= size) return -1;
+  }
+  return len;
+}
+
+/*
+ * function that returns result published to path,
+ * if it is younger than shared_ttl_ms, NULL otherwise
+ */
+static char *
+shared_read(const char *path)
+{
+  struct stat st;
+  struct timespec now;
+  char *value = NULL;
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return NULL;
+  clock_gettime(CLOCK_REALTIME, &now);
+  if (fstat(fd, &st) == 0 &&
+      (now.tv_sec - st.st_mtim.tv_sec) * 1000LL +
+      (now.tv_nsec - st.st_mtim.tv_nsec) / 1000000 <= shared_ttl_ms &&
+      (value = malloc(st.st_size + 1))) {
+    if (read(fd, value, st.st_size) == st.st_size) {
+      value[st.st_size] = '\0';
+    } else {
+      free(value);
+      value = NULL;
+    }
+  }
+  close(fd);
+  return value;
+}
+
+/*
+ * function that publishes result to path (temporary file and rename)
+ */
+static void
+shared_write(const char *path, const char *value)
+{
+  char tmp[4096 + 8];
+  snprintf(tmp, sizeof tmp, "%s.XXXXXX", path);
+  int fd = mkstemp(tmp);
+  if (fd < 0) return;
+  size_t len = strlen(value);
+  if (write(fd, value, len) != (ssize_t)len || close(fd) != 0 ||
+      rename(tmp, path) != 0)
+    unlink(tmp);
+}
+
+/*
+ * function that runs module of item,
+ * ITEM_SHARED module runs once for processes started together:
+ * first one takes flock on item.<label>.lock in state directory,
+ * runs module and publishes result to item.<label>, others wait for it
+ * (at most shared_wait_ms) and read the result, lock of crashed process
+ * is released by kernel, so the next one runs module,
+ * ITEM_ENV result is shared only with the same daemon_env variables,
+ * shell binary and terminal emulator
+ */
+char *
+item_run(const info_item *item)
+{
+  char name[128], path[4096], lock[sizeof path + 8];
+
+  /* capture must see every read, replay serves every read */
+  if (!(item->flags & ITEM_SHARED) || shared_ttl_ms <= 0 ||
+      io_mode() != IO_DIRECT)
+    return item->func();
+
+  int len = snprintf(name, sizeof name, "item.%s", item->label);
+  for (char *p = name + 5; *p; p++)
+    if (!isalnum((unsigned char)*p)) *p = '_';
+  if (item->flags & ITEM_ENV) {
+    /* environment and parents: shell and terminal of ancestry() */
+    const struct ancestry *a = ancestry();
+    char env[4096];
+    if (env_block(env, sizeof env) < 0) return item->func();
+    uint32_t h = hash_str(a->shell_exe, 0);
+    if (a->terminal >= 0) h = hash_str(a->procs[a->terminal].comm, h);
+    snprintf(name + len, sizeof name - len, ".%08x", hash_str(env, h));
+  }
+  if (state_path(name, path, sizeof path) != 0)
+    return item->func();
+
+  char *value = shared_read(path);
+  if (value) return value;
 
-      res.entries[res.count].value = strdup(line);
-      res.count++;
+  snprintf(lock, sizeof lock, "%s.lock", path);
+  int fd = open(lock, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) return item->func();
 
-      line = strtok(NULL, "\n");
-      number++;
+  long waited = 0, delay = 1;
+  while (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+    if ((value = shared_read(path)) || waited >= shared_wait_ms) {
+      close(fd);
+      return value ? value : item->func();
     }
-    free(value);
+    struct timespec ts = { 0, delay * 1000000L };
+    nanosleep(&ts, NULL);
+    waited += delay;
+    if (delay < 8) delay *= 2;
+  }
+
+  /* leader, or leader crashed */
+  if (!(value = shared_read(path)) && (value = item->func()))
+    shared_write(path, value);
+  close(fd);
+  return value;
+}
+
+/*
+ * function that:
+ * 1. if (align_info) add padding to label
+ * 2. runs only modules marked in run[] (all, if run is NULL),
+ *    others take item_rows() empty rows, that aren't printed
+ * 3. return info_list, with malloc!
+ */
+info_list
+render_info(info_item infos[], size_t info_size, const bool *run)
+{
+  info_list res = {NULL, 0};
+  size_t maxlen = label_width(infos, info_size);
+
+  for (size_t i = 0; i < info_size; i++) {
+    if (run && !run[i]) {
+      for (int r = 0; r < item_rows(&infos[i]); r++)
+        add_row(&res, NULL, NULL, maxlen, false);
+      continue;
+    }
+    render_value(&res, &infos[i], item_run(&infos[i]), maxlen);
   }
   return res; 
 }
@@ -263,49 +606,32 @@ trim(char *str)
 
 
 /*
- * function that prints header
+ * function that fills header: user, separator, hostname and
+ * boundary under them
  * returns:
  *  > 0: header length
  *  < 0: error
  */
 int
-print_header(int term_width, int *curw)
+get_header(header *h)
 {
-  char *name = getenv("USER");
-  char hostname[256];
-  if (gethostname(hostname, sizeof(hostname)) != 0) {
+  h->name = getenv("USER");
+  h->sep = (char *)header_sep;
+  if (gethostname(h->hostname, sizeof(h->hostname)) != 0) {
     perror("gethostname error");
     return -1; 
   } 
-
-  printf("\x1b[0m"); /* reset color */
-  printf("\x1b[%dm", colors[1]);
-  if(!puts_limited(name, term_width, curw, true)) {
-    printf("\x1b[%dm", colors[7]);
-    if(!puts_limited(header_sep, term_width, curw, true)) {
-      printf("\x1b[%dm", colors[2]);
-      puts_limited(hostname, term_width, curw, true);
-    }
+  h->hostname[sizeof(h->hostname) - 1] = '\0';
+  if (!h->name) {
+    struct passwd *pw = getpwuid(getuid());
+    h->name = pw ? pw->pw_name : "unknown";
   }
 
-
-  return strlen(name) + strlen(header_sep) + strlen(hostname);
-}
-
-/*
- * function that prints boundary
- */
-void
-print_boundary(const char c, int len, int term_width, int *curw)
-{
-  printf("\x1b[%dm", colors[8]);
-  char s[len];
-  for(int i = 0; i < len; i++) 
-  {
-    s[i] = c;
-  }
-  puts_limited(s, term_width, curw, true);
-  printf("\x1b[0m"); /* reset color */
+  size_t len = strlen(h->name) + strlen(h->sep) + strlen(h->hostname);
+  if (len >= sizeof(h->boundary)) len = sizeof(h->boundary) - 1;
+  memset(h->boundary, boundary_char, len);
+  h->boundary[len] = '\0';
+  return len;
 }
 
 /*
@@ -410,172 +736,1536 @@ get_ascii_size(struct ascii *res)
 
 
 /*
- * fill all struct ascii fields and return final structure
+ * function that decompresses LZ4 block src to dst of exactly len bytes
+ * returns 0 on success, -1 on corrupted data
  */
-struct ascii
-get_ascii()
+int
+lz4_decompress(const unsigned char *src, size_t zlen, char *dst, size_t len)
 {
-  struct ascii res = {0};
-  res.art = strdup(ascii_art);
+  const unsigned char *end = src + zlen;
+  size_t o = 0;
+
+  while (src < end) {
+    unsigned token = *src++;
+    size_t n = token >> 4;
+    if (n == 15)
+      do { n += *src; } while (src < end && *src++ == 255);
+    if (n > (size_t)(end - src) || n > len - o) return -1;
+    memcpy(dst + o, src, n);
+    src += n;
+    o += n;
+    if (src >= end) break; /* last literals */
+
+    if (end - src < 2) return -1;
+    size_t off = src[0] | src[1] << 8;
+    src += 2;
+    n = (token & 15) + 4;
+    if ((token & 15) == 15)
+      do { n += *src; } while (src < end && *src++ == 255);
+    if (off == 0 || off > o || n > len - o) return -1;
+    while (n--) {
+      dst[o] = dst[o - off];
+      o++;
+    }
+  }
+  return o == len ? 0 : -1;
+}
 
-  get_ascii_size(&res);
-  return res;
+/*
+ * function that returns malloc copy of logo for os-release id,
+ * NULL if there is no such logo
+ */
+char *
+logo_get(const char *id)
+{
+  uint32_t i = hash_str(id, LOGO_SEED) & (LOGO_SLOTS - 1);
+  if (!logos[i].id || strcmp(logos[i].id, id) != 0) return NULL;
+
+  char *art = malloc(logos[i].len + 1);
+  if (!art) return NULL;
+  if (lz4_decompress(logo_data + logos[i].off, logos[i].zlen,
+                     art, logos[i].len) != 0) {
+    free(art);
+    return NULL;
+  }
+  art[logos[i].len] = '\0';
+  return art;
 }
 
+/*
+ * function that selects logo by os-release ID, then by ID_LIKE
+ * ("rocky" -> "rhel centos fedora"), returns malloc string or NULL
+ */
+char *
+logo_find(void)
+{
+  const struct os_release *rel = os_release();
+  char like[sizeof rel->id_like];
+  char *art = rel->id[0] ? logo_get(rel->id) : NULL;
+
+  snprintf(like, sizeof like, "%s", rel->id_like);
+  char *save;
+  for (char *p = strtok_r(like, " ", &save); p && !art;
+       p = strtok_r(NULL, " ", &save))
+    art = logo_get(p);
+  return art;
+}
 
 /*
- * function that print:
- * - ascii art with colors from config, with processing like:
- *     $1 - cfg.colors[1]
- * - information with print_info(), takes size of infos (size_t infos_size)
- *
- * if return < 0:
- * - 
+ * function that copies bytes from off to end of fd to out_fd,
+ * with sendfile, by hand if out_fd doesn't support it
  */
+void
+copy_fd(int fd, off_t off, off_t end, int out_fd)
+{
+  while (off < end && sendfile(out_fd, fd, &off, end - off) > 0)
+    ;
+
+  char buf[4096];
+  ssize_t n;
+  while (off < end &&
+         (n = pread(fd, buf, end - off < 4096 ? end - off : 4096, off)) > 0) {
+    if (write(out_fd, buf, n) != n) break;
+    off += n;
+  }
+}
 
+/*
+ * function that returns first line of info block (header) in frame,
+ * and its column in col
+ */
 int
-print_fetch(struct ascii *res)
+info_origin(const struct ascii *art, int *col)
 {
-  char        *p = res->art;
-  int       curw = 0;
-  char cur_color = '7';
-  int   cur_info = 0;
-  int header_len = 0;
-  int term_width = 0;
+  *col = (layout == LAYOUT_ART_LEFT && art->width > 0) ?
+         art->width + ascii_pad : 0;
+  return layout == LAYOUT_ART_TOP ? art->height : 0;
+}
 
-  struct winsize ws;
-  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0)
-    term_width = ws.ws_col;
-
-  info_list infos = render_info(config_items, config_items_len);
-
-  while (*p || (size_t)cur_info < infos.count +
-        ((color_palette_show == 1) ? 3 : 0)) {
-    if (*p) {
-      /* check color */
-      if (*p == '$' && isdigit(*(p + 1))) {
-        cur_color = *++p;
-        printf("\x1b[%dm", colors[cur_color - '0']);
-        p++;
-        continue;
-      }
-      /* print char */
-      if (*p != '\n') {
-        if (term_width > 0 && curw >= term_width - 2 && line_break) {
-          printf(" \x1b[%dm%c", colors[9], line_break_char);
-          while (*p && *p != '\n') p++;
-          curw = res->width + ascii_pad;
-          continue;
-        }
-        putchar(*p);
-        p++;
-        curw++;
-        continue;
-      }
-      p++;
-    }
+/*
+ * function that returns lines of frame with art and info block
+ * of info_lines lines
+ */
+int
+frame_lines(const struct ascii *art, int info_lines)
+{
+  if (layout == LAYOUT_ART_TOP || layout == LAYOUT_ART_BOTTOM)
+    return art->height + info_lines;
+  return art->height > info_lines ? art->height : info_lines;
+}
 
-    /* add padding */
-    if (res->width > 0) {
-      while (curw != res->width + ascii_pad) {
-        if (term_width > 0 && curw >= term_width) {
-          curw = res->width + ascii_pad;
-          break;
-        }
-        putchar(' ');
-        curw++;
-      }
-    }
+/*
+ * function that returns the most lines frame with art may take
+ */
+int
+frame_height(const struct ascii *art)
+{
+  int height = (header_show ? 2 : 0) + (color_palette_show ? 3 : 0);
+  for (size_t i = 0; i < config_items_len; i++)
+    height += item_rows(&config_items[i]);
+  return frame_lines(art, height);
+}
 
-    /* skip info/header if no space */
-    if (term_width > 0 && curw >= term_width - 2) {
-      if (header_len == 0 && header_show != 0)
-        header_len = -1;
-      else if (header_len > 0)
-        header_len = -1;
-      else if ((size_t)cur_info < infos.count +
-               ((color_palette_show == 1) ? 3 : 0))
-        cur_info++;
-      goto print_fetch_end;
-    }
+/*
+ * function that makes art of image_path: cached payload, that
+ * print_fetch() draws over the frame, and empty lines of its size
+ * in cells, so info column lines up, only if terminal has graphics,
+ * reports its size in pixels and the frame fits in it
+ * returns 0 on success, -1 if ascii art should be used
+ */
+static int
+image_logo(struct ascii *res)
+{
+  struct winsize ws;
+  int rows, protocol = image_detect(image_protocol);
 
-    /* print header */
-    if (header_len == 0 && header_show != 0) {
-      header_len = print_header(term_width, &curw);
-      if (header_len < 0) {
-        fprintf(stderr, "Header Error: %d", header_len);
-        exit(EXIT_FAILURE);
-      }
-      goto print_fetch_end;
-    } else if (header_len > 0) {
-      print_boundary(boundary_char, header_len, term_width, &curw);
-      header_len = -1;
-      goto print_fetch_end;
-    }
+  if (protocol == IMAGE_NONE ||
+      ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != 0 ||
+      !ws.ws_col || !ws.ws_row || !ws.ws_xpixel || !ws.ws_ypixel)
+    return -1;
 
-    /* print boundary for palette */
-    if ((size_t)cur_info == infos.count && color_palette_show) {
-      cur_info++;
-      goto print_fetch_end;
-    }
+  int fd = image_open(image_path, protocol, image_width,
+                      ws.ws_xpixel / ws.ws_col, ws.ws_ypixel / ws.ws_row,
+                      &rows, &res->image_off, &res->image_len);
+  if (fd < 0) return -1;
 
-    /* print normal palette */
-    if ((size_t)cur_info == infos.count + 1 && color_palette_show) {
-      for (int i = 0; i < 8; i++) {
-        printf("\x1b[4%dm", i);
-        if (puts_limited("   ", term_width, &curw, false))
-          break;
-      }
-      cur_info++;
-      goto print_fetch_end;
-    }
+  res->width = image_width;
+  res->height = rows;
+  /* image is drawn from the top of frame, it mustn't scroll */
+  if (frame_height(res) >= ws.ws_row || !(res->art = malloc(rows + 1))) {
+    close(fd);
+    return -1;
+  }
+  memset(res->art, '\n', rows);
+  res->art[rows] = '\0';
+  res->image = fd;
+  return 0;
+}
 
-    /* print bright palette */
-    if ((size_t)cur_info == infos.count + 2 && color_palette_show) {
-      for (int i = 0; i < 8; i++) {
-        printf("\x1b[10%dm", i);
-        if (puts_limited("   ", term_width, &curw, false))
-          break;
-      }
-      cur_info++;
-      goto print_fetch_end;
-    }
+/*
+ * function that returns logo: image (if image and image_path),
+ * logo of the system (if ascii_auto) or ascii_art
+ */
+struct ascii
+get_ascii(bool image)
+{
+  struct ascii res = { .image = -1 };
+  if (image && image_path && image_logo(&res) == 0)
+    return res;
+  if (ascii_auto)
+    res.art = logo_find();
+  if (!res.art)
+    res.art = strdup(ascii_art);
 
-    /* print info */
-    if ((size_t)cur_info < infos.count) {
-      printf("\x1b[0m");
-      printf("\x1b[%dm", colors[1]);
-      if (!puts_limited(infos.entries[cur_info].label, term_width, &curw, true)) {
-        printf("\x1b[%dm", colors[6]);
-        if (!puts_limited(info_sep, term_width, &curw, true)) {
-          printf("\x1b[%dm", colors[5]);
-          puts_limited(infos.entries[cur_info].value, term_width, &curw, true);
-        }
-      }
-      cur_info++;
-    }
+  get_ascii_size(&res);
+  return res;
+}
 
-    print_fetch_end:
-      curw = 0;
-      printf("\x1b[0m");
-      printf("\n");
-      printf("\x1b[%dm", colors[cur_color - '0']);
-  }
-  printf("\x1b[0m");
 
-  free_info_list(&infos);
-  return 0;
-}
+/*
+ * frame layout: every row is an array of segments, pieces of art,
+ * header, info and palette with colors, frame is built once from them,
+ * widths are solved on whole blocks, and then rows are printed,
+ * segments point to strings of art and info_list, so they must live
+ * while the block is used
+ */
 
-int
-main(void)
+/* text of s, or len spaces if s is NULL */
+typedef struct
 {
-  struct ascii art = get_ascii();
+  const char *s;
+  int len;         /* bytes, that is cells */
+  int fg;
+  int bg;
+  bool brk;        /* show line_break_char, if it's cut */
+} segment;
 
-  print_fetch(&art);
+typedef struct
+{
+  segment *segs;
+  size_t count;
+  size_t size;
+  size_t *rows;    /* first segment of every row */
+  int *widths;     /* cells of every row */
+  int lines;
+  int width;       /* the widest row */
+} block;
+
+/* frame and where art (image) is in it */
+typedef struct
+{
+  block rows;
+  int art_line;
+  int art_col;
+} frame;
 
-  free_ascii(&art);
-  return 0;
+void
+free_block(block *b)
+{
+  free(b->segs);
+  free(b->rows);
+  free(b->widths);
+  *b = (block){0};
+}
 
+/*
+ * function that starts new row of b
+ */
+void
+block_row(block *b)
+{
+  b->rows = realloc(b->rows, sizeof(size_t) * (b->lines + 1));
+  b->widths = realloc(b->widths, sizeof(int) * (b->lines + 1));
+  if (!b->rows || !b->widths) {
+    perror("realloc");
+    exit(EXIT_FAILURE);
+  }
+  b->rows[b->lines] = b->count;
+  b->widths[b->lines++] = 0;
+}
 
+/*
+ * function that appends segment to the last row of b
+ */
+void
+block_add(block *b, segment seg)
+{
+  if (b->count == b->size) {
+    b->size = b->size ? b->size * 2 : 64;
+    b->segs = realloc(b->segs, sizeof(segment) * b->size);
+    if (!b->segs) {
+      perror("realloc");
+      exit(EXIT_FAILURE);
+    }
+  }
+  b->segs[b->count++] = seg;
+  b->widths[b->lines - 1] += seg.len;
+  if (b->widths[b->lines - 1] > b->width)
+    b->width = b->widths[b->lines - 1];
+}
+
+/*
+ * function that returns end of segments of row r
+ */
+size_t
+block_end(const block *b, int r)
+{
+  return r + 1 < b->lines ? b->rows[r + 1] : b->count;
+}
+
+/*
+ * function that splits art to rows of segments by colors:
+ *     $1 - cfg.colors[1]
+ * in one pass, color goes on to the next lines
+ */
+void
+art_block(block *b, const struct ascii *art)
+{
+  const char *p = art->art;
+  int fg = colors[7];
+
+  if (!p || !*p) return;
+  block_row(b);
+  while (*p) {
+    const char *start = p;
+    while (*p && *p != '\n' && !(*p == '$' && isdigit(*(p + 1)))) p++;
+    if (p > start)
+      block_add(b, (segment){ start, p - start, fg, 0, true });
+
+    if (*p == '$') {
+      fg = colors[*(p + 1) - '0'];
+      p += 2;
+    } else if (*p == '\n' && *++p) {
+      block_row(b);
+    }
+  }
+}
+
+/*
+ * function that adds info row "label: value" to b,
+ * rows of modules, that weren't run, stay empty
+ */
+void
+info_row(block *b, const rendered_info *row)
+{
+  block_row(b);
+  if (!row->value) return;
+
+  block_add(b, (segment){ row->label, strlen(row->label), colors[1], 0, true });
+  block_add(b, (segment){ info_sep, strlen(info_sep), colors[6], 0, true });
+  block_add(b, (segment){ row->value, strlen(row->value),
+                          colors[row->pending ? 8 : 5], 0, true });
+}
+
+/*
+ * function that makes block of header, its boundary,
+ * infos (see render_info()) and color palette
+ */
+void
+info_block(block *b, info_list *infos, header *h)
+{
+  if (header_show) {
+    int header_len = get_header(h);
+    if (header_len < 0) {
+      fprintf(stderr, "Header Error: %d", header_len);
+      exit(EXIT_FAILURE);
+    }
+    block_row(b);
+    block_add(b, (segment){ h->name, strlen(h->name), colors[1], 0, true });
+    block_add(b, (segment){ h->sep, strlen(h->sep), colors[7], 0, true });
+    block_add(b, (segment){ h->hostname, strlen(h->hostname),
+                            colors[2], 0, true });
+    block_row(b);
+    block_add(b, (segment){ h->boundary, strlen(h->boundary),
+                            colors[8], 0, true });
+  }
+
+  for (size_t i = 0; i < infos->count; i++)
+    info_row(b, &infos->entries[i]);
+
+  if (color_palette_show) {
+    block_row(b);
+    for (int base = 40; base <= 100; base += 60) {
+      block_row(b);
+      for (int i = 0; i < 8; i++)
+        block_add(b, (segment){ "   ", 3, 0, base + i, false });
+    }
+  }
+}
+
+/*
+ * function that puts rows of right beside rows of left, right starts
+ * at column col (rows of left are padded), right is dropped if
+ * it doesn't fit in term_width
+ */
+void
+block_beside(block *dst, const block *left, const block *right, int col,
+             int term_width)
+{
+  bool show = !(term_width > 0 && col >= term_width - 2);
+  int lines = left->lines > right->lines ? left->lines : right->lines;
+
+  for (int r = 0; r < lines; r++) {
+    block_row(dst);
+    if (r < left->lines)
+      for (size_t i = left->rows[r]; i < block_end(left, r); i++)
+        block_add(dst, left->segs[i]);
+    if (!show || r >= right->lines || right->rows[r] == block_end(right, r))
+      continue;
+    if (dst->widths[dst->lines - 1] < col)
+      block_add(dst, (segment){ NULL, col - dst->widths[dst->lines - 1],
+                                0, 0, false });
+    for (size_t i = right->rows[r]; i < block_end(right, r); i++)
+      block_add(dst, right->segs[i]);
+  }
+}
+
+/*
+ * function that puts rows of bottom below rows of top
+ */
+void
+block_below(block *dst, const block *top, const block *bottom)
+{
+  const block *parts[] = { top, bottom };
+  for (int p = 0; p < 2; p++)
+    for (int r = 0; r < parts[p]->lines; r++) {
+      block_row(dst);
+      for (size_t i = parts[p]->rows[r]; i < block_end(parts[p], r); i++)
+        block_add(dst, parts[p]->segs[i]);
+    }
+}
+
+/*
+ * function that builds frame of art and infos by layout
+ */
+void
+layout_build(frame *f, const struct ascii *art, info_list *infos,
+             header *h, int term_width)
+{
+  block a = {0}, i = {0};
+  int col;
+
+  art_block(&a, art);
+  info_block(&i, infos, h);
+  *f = (frame){0};
+  f->art_line = 0;
+
+  switch (layout) {
+  case LAYOUT_ART_RIGHT:
+    f->art_col = i.width + ascii_pad;
+    block_beside(&f->rows, &i, &a, f->art_col, term_width);
+    break;
+  case LAYOUT_ART_TOP:
+    block_below(&f->rows, &a, &i);
+    break;
+  case LAYOUT_ART_BOTTOM:
+    f->art_line = i.lines;
+    block_below(&f->rows, &i, &a);
+    break;
+  default:
+    info_origin(art, &col);
+    block_beside(&f->rows, &a, &i, col, term_width);
+    break;
+  }
+  /* image art is empty lines, they may be shorter than art->height */
+  while (f->rows.lines < frame_lines(art, i.lines))
+    block_row(&f->rows);
+
+  free_block(&a);
+  free_block(&i);
+}
+
+/*
+ * function that prints row r of b from column curw,
+ * term_width - width to fit in, 0 means unlimited,
+ * with line_break text is cut 2 cells before it (line_break_char)
+ */
+void
+row_print(const block *b, int r, int curw, int term_width)
+{
+  for (size_t i = b->rows[r]; i < block_end(b, r); i++) {
+    const segment *s = &b->segs[i];
+    int room = s->len;
+
+    sgr_reset();
+    sgr_fg(s->fg);
+    sgr_bg(s->bg);
+    if (term_width > 0 && !s->s && curw + s->len > term_width)
+      room = term_width - curw;
+    else if (term_width > 0 && s->s && line_break &&
+             curw + s->len > term_width - 2)
+      room = term_width - 2 > curw ? term_width - 2 - curw : 0;
+
+    if (room > 0 && s->s)
+      out_bytes(s->s, room);
+    else if (room > 0)
+      out_spaces(room);
+    curw += room;
+
+    if (room < s->len) {
+      if (s->brk) {
+        out_bytes(" ", 1);
+        sgr_fg(colors[9]);
+        out_bytes(&line_break_char, 1);
+      }
+      return;
+    }
+  }
+}
+
+/*
+ * function that prints:
+ * - ascii art with colors from config
+ * - information from infos (see render_info())
+ * placed by layout
+ * term_width - width to fit in, 0 means unlimited
+ *
+ * returns count of printed lines
+ */
+
+int
+print_fetch(struct ascii *res, info_list *infos, int term_width)
+{
+  frame f;
+  header h;
+
+  layout_build(&f, res, infos, &h, term_width);
+  for (int r = 0; r < f.rows.lines; r++) {
+    row_print(&f.rows, r, 0, term_width);
+    sgr_reset();
+    sgr_sync('\n');
+    putc('\n', out);
+  }
+  sgr_finish();
+
+  /* image over the empty art lines, cursor stays below the frame */
+  if (res->image >= 0) {
+    fprintf(out, "\x1b" "7\x1b[%dA\r", f.rows.lines - f.art_line);
+    if (f.art_col > 0) fprintf(out, "\x1b[%dC", f.art_col);
+    fflush(out);
+    copy_fd(res->image, res->image_off, res->image_off + res->image_len,
+            fileno(out));
+    fputs("\x1b" "8", out);
+  }
+
+  int lines = f.rows.lines;
+  free_block(&f.rows);
+  return lines;
+}
+
+/*
+ * function that returns size of terminal on stdout, 0 if not a terminal
+ */
+void
+get_term_size(int *width, int *height)
+{
+  struct winsize ws;
+  *width = *height = 0;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0) {
+    *width = ws.ws_col;
+    *height = ws.ws_row;
+  }
+}
+
+/*
+ * function that marks in run[] modules, whose rows will be seen:
+ * - none, if info column doesn't fit in terminal width
+ * - if info_skip_scrolled, not modules, that scroll out of terminal
+ *   above the frame for sure, module takes at most item_rows() rows,
+ *   not run module takes exactly item_rows(), so rows below can't move up
+ */
+void
+visible_items(struct ascii *art, int term_width, int term_height, bool *run)
+{
+  int col;
+  int line = info_origin(art, &col);
+  int end = header_show ? 2 : 0; /* header and boundary */
+  int palette = color_palette_show ? 3 : 0;
+
+  for (size_t i = 0; i < config_items_len; i++)
+    run[i] = !(term_width > 0 && col >= term_width - 2);
+
+  if (!info_skip_scrolled || term_height <= 1)
+    return;
+
+  for (size_t i = 0; i < config_items_len && run[i]; i++) {
+    int rows = item_rows(&config_items[i]);
+    /* lowest frame: every module below prints one row */
+    int below = (int)(config_items_len - i - 1) + palette;
+    int height = frame_lines(art, end + rows + below);
+
+    /* last row of prompt is taken by shell */
+    if (line + end + rows > height - (term_height - 1))
+      break;
+    run[i] = false;
+    end += rows;
+  }
+}
+
+/* module, that runs in its own thread (progressive mode) */
+typedef struct
+{
+  const info_item *item;
+  pthread_t thread;
+  bool started;
+  bool done;       /* value is ready */
+  bool shown;      /* value is printed */
+  char *value;
+  int first_row;   /* index of first row in info_list */
+} module_job;
+
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  jobs_cond = PTHREAD_COND_INITIALIZER;
+
+static void *
+job_run(void *arg)
+{
+  module_job *job = arg;
+  char *value = item_run(job->item);
+
+  pthread_mutex_lock(&jobs_lock);
+  job->value = value;
+  job->done = true;
+  pthread_cond_broadcast(&jobs_cond);
+  pthread_mutex_unlock(&jobs_lock);
+  return NULL;
+}
+
+/*
+ * function that waits (jobs_lock is held) until deadline or until
+ * a job, that isn't shown yet, is done (or every job, if all)
+ * returns that job, NULL on timeout or if everything is shown
+ */
+static module_job *
+jobs_wait(module_job *jobs, size_t n, const struct timespec *deadline,
+          bool all)
+{
+  for (;;) {
+    module_job *ready = NULL;
+    bool waiting = false;
+    for (size_t i = 0; i < n; i++) {
+      if (!jobs[i].started || jobs[i].shown) continue;
+      if (jobs[i].done && !ready) ready = &jobs[i];
+      if (!jobs[i].done) waiting = true;
+    }
+    if (ready && !all) return ready;
+    if (!waiting) return ready;
+    if (deadline) {
+      if (pthread_cond_timedwait(&jobs_cond, &jobs_lock, deadline) != 0)
+        return NULL;
+    } else {
+      pthread_cond_wait(&jobs_cond, &jobs_lock);
+    }
+  }
+}
+
+/*
+ * function that makes rows of frame from jobs: shown modules with their
+ * rows, pending ones with placeholder (one row), not run ones take
+ * item_rows() empty rows (see visible_items()), and first_row of jobs
+ */
+static void
+jobs_infos(module_job *jobs, const bool *run, size_t maxlen, info_list *infos)
+{
+  *infos = (info_list){NULL, 0};
+  for (size_t i = 0; i < config_items_len; i++) {
+    jobs[i].first_row = infos->count;
+    if (!run[i]) {
+      for (int r = 0; r < item_rows(jobs[i].item); r++)
+        add_row(infos, NULL, NULL, maxlen, false);
+    } else if (jobs[i].shown) {
+      render_value(infos, jobs[i].item,
+                   jobs[i].value ? strdup(jobs[i].value) : NULL, maxlen);
+    } else {
+      add_row(infos, jobs[i].item->label, progressive_placeholder,
+              maxlen, true);
+    }
+  }
+}
+
+/*
+ * function that marks done jobs shown (jobs_lock is held)
+ * returns true if some job is still running
+ */
+static bool
+jobs_show(module_job *jobs, const bool *run)
+{
+  bool pending = false;
+  for (size_t i = 0; i < config_items_len; i++) {
+    if (!run[i]) continue;
+    if (jobs[i].done) jobs[i].shown = true;
+    else pending = true;
+  }
+  return pending;
+}
+
+/*
+ * function that returns lines of info block with infos
+ */
+static int
+info_lines(const info_list *infos)
+{
+  return (header_show ? 2 : 0) + (int)infos->count +
+         (color_palette_show ? 3 : 0);
+}
+
+/*
+ * function that rewrites placeholder row of finished job with first row
+ * of its rows in already printed frame: saves cursor (below the frame),
+ * goes up to the row, prints it, clears the rest of line and restores
+ * cursor
+ */
+static void
+patch_job(module_job *job, info_list *rows, int lines, int row_base, int col,
+          int term_width)
+{
+  block b = {0};
+  struct sgr saved = sgr_term;
+  int line = row_base + job->first_row;
+
+  if (rows->count) info_row(&b, &rows->entries[0]);
+  fprintf(out, "\x1b" "7\x1b[%dA\x1b[%dG", lines - line, col + 1);
+  if (b.lines) row_print(&b, 0, col, term_width);
+  sgr_reset();
+  sgr_sync('\n'); /* no background for clear */
+  fputs("\x1b[K\x1b" "8", out);
+  sgr_term = saved; /* DECRC restores attributes too */
+  free_block(&b);
+}
+
+/*
+ * function that prints frame again over the printed one of lines lines,
+ * when module printed more rows than its placeholder took: rows below
+ * it move down, cursor ends below the frame
+ * returns count of printed lines
+ */
+static int
+reprint_frame(struct ascii *art, module_job *jobs, const bool *run,
+              size_t maxlen, int lines, int term_width)
+{
+  info_list infos;
+
+  sgr_reset();
+  sgr_sync('\n'); /* no background for clear */
+  fprintf(out, "\x1b[%dA\r\x1b[J", lines);
+  jobs_infos(jobs, run, maxlen, &infos);
+  lines = print_fetch(art, &infos, term_width);
+  free_info_list(&infos);
+  return lines;
+}
+
+/*
+ * function that prints frame at once, modules, that didn't finish
+ * in progressive_wait_ms, get placeholder row, that is patched in place
+ * as the module finishes, or the frame is printed again, if module
+ * printed more rows, cursor ends below the frame
+ * falls back to blocking print if frame doesn't fit in terminal
+ */
+void
+print_progressive(struct ascii *art, const bool *run, int term_width,
+                  int term_height)
+{
+  module_job jobs[config_items_len];
+  size_t maxlen = label_width(config_items, config_items_len);
+  info_list infos;
+  struct timespec deadline;
+  int col;
+  int row_base = info_origin(art, &col) + (header_show ? 2 : 0);
+
+  for (size_t i = 0; i < config_items_len; i++) {
+    jobs[i] = (module_job){ .item = &config_items[i] };
+    if (!run[i]) continue;
+    jobs[i].started =
+      pthread_create(&jobs[i].thread, NULL, job_run, &jobs[i]) == 0;
+    if (!jobs[i].started) {
+      jobs[i].value = item_run(&config_items[i]);
+      jobs[i].done = true;
+    }
+  }
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += progressive_wait_ms * 1000000L;
+  deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+  deadline.tv_nsec %= 1000000000L;
+
+  /* patched rows would clear art right of them, wait for all */
+  pthread_mutex_lock(&jobs_lock);
+  jobs_wait(jobs, config_items_len,
+            layout == LAYOUT_ART_RIGHT ? NULL : &deadline, true);
+  bool pending = jobs_show(jobs, run);
+  jobs_infos(jobs, run, maxlen, &infos);
+
+  /* rows would scroll out before they're patched, wait for all */
+  if (pending && frame_lines(art, info_lines(&infos)) >= term_height) {
+    jobs_wait(jobs, config_items_len, NULL, true);
+    pending = jobs_show(jobs, run);
+    free_info_list(&infos);
+    jobs_infos(jobs, run, maxlen, &infos);
+  }
+  pthread_mutex_unlock(&jobs_lock);
+
+  int lines = print_fetch(art, &infos, term_width);
+  int info = info_lines(&infos);
+  fflush(out);
+  free_info_list(&infos);
+
+  pthread_mutex_lock(&jobs_lock);
+  module_job *job;
+  while (pending && (job = jobs_wait(jobs, config_items_len, NULL, false))) {
+    info_list rows = {NULL, 0};
+    job->shown = true;
+    render_value(&rows, job->item, job->value ? strdup(job->value) : NULL,
+                 maxlen);
+
+    if (rows.count <= 1) {
+      pthread_mutex_unlock(&jobs_lock);
+      patch_job(job, &rows, lines, row_base, col, term_width);
+    } else {
+      /* top of taller frame would scroll out, so it's the last print */
+      info += rows.count - 1;
+      if (frame_lines(art, info) >= term_height) {
+        jobs_wait(jobs, config_items_len, NULL, true);
+        jobs_show(jobs, run);
+      }
+      pthread_mutex_unlock(&jobs_lock);
+      lines = reprint_frame(art, jobs, run, maxlen, lines, term_width);
+    }
+    free_info_list(&rows);
+    fflush(out);
+    pthread_mutex_lock(&jobs_lock);
+  }
+  pthread_mutex_unlock(&jobs_lock);
+
+  for (size_t i = 0; i < config_items_len; i++) {
+    if (jobs[i].started) pthread_join(jobs[i].thread, NULL);
+    free(jobs[i].value);
+  }
+}
+
+/*
+ * function that renders frame for every width in motd_widths,
+ * to "path.width" ("path" for unlimited width, without colors, --cat
+ * prints it when output isn't a terminal), each file is written
+ * to temporary file and renamed, so readers never see half of frame
+ * returns 0 on success, -1 on error
+ */
+int
+render_to(const char *path, struct ascii *art, info_list *infos)
+{
+  char dst[4096], tmp[sizeof dst + 8];
+
+  for (size_t i = 0; i < sizeof motd_widths / sizeof motd_widths[0]; i++) {
+    /* --cat prints the others on a terminal */
+    sgr_on = motd_widths[i] > 0;
+    if (motd_widths[i] > 0)
+      snprintf(dst, sizeof dst, "%s.%d", path, motd_widths[i]);
+    else
+      snprintf(dst, sizeof dst, "%s", path);
+    snprintf(tmp, sizeof tmp, "%s.XXXXXX", dst);
+
+    int fd = mkstemp(tmp);
+    if (fd < 0 || !(out = fdopen(fd, "w"))) {
+      perror(tmp);
+      if (fd >= 0) close(fd);
+      out = stdout;
+      return -1;
+    }
+    fchmod(fd, 0644);
+
+    sgr_term = sgr_pen = (struct sgr){0};
+    print_fetch(art, infos, motd_widths[i]);
+
+    int err = ferror(out);
+    if (fclose(out) != 0 || err || rename(tmp, dst) != 0) {
+      perror(dst);
+      unlink(tmp);
+      out = stdout;
+      return -1;
+    }
+  }
+  out = stdout;
+  return 0;
+}
+
+/*
+ * function that prints frame rendered by render_to(),
+ * the widest one that fits in terminal
+ * returns 0 on success, -1 if no frame was found
+ */
+int
+cat_frame(const char *path)
+{
+  char src[4096];
+  int term_width, term_height;
+  get_term_size(&term_width, &term_height);
+  int best = 0, narrowest = 0;
+
+  /* widest bucket that fits, or the narrowest one */
+  for (size_t i = 0; i < sizeof motd_widths / sizeof motd_widths[0]; i++) {
+    int w = motd_widths[i];
+    if (w <= 0) continue;
+    if (w <= term_width && w > best) best = w;
+    if (!narrowest || w < narrowest) narrowest = w;
+  }
+  if (term_width > 0 && !best) best = narrowest;
+
+  if (best > 0)
+    snprintf(src, sizeof src, "%s.%d", path, best);
+  else
+    snprintf(src, sizeof src, "%s", path);
+
+  int fd = open(src, O_RDONLY);
+  if (fd < 0) return -1;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  copy_fd(fd, 0, st.st_size, STDOUT_FILENO);
+  close(fd);
+  return 0;
+}
+
+/*
+ * function that fills addr with path of daemon socket
+ * returns 0 on success, -1 on error
+ */
+static int
+daemon_addr(struct sockaddr_un *addr)
+{
+  char path[sizeof addr->sun_path];
+
+  memset(addr, 0, sizeof *addr);
+  addr->sun_family = AF_UNIX;
+  if (state_path("sock", path, sizeof path) != 0)
+    return -1;
+  memcpy(addr->sun_path, path, sizeof path);
+  return 0;
+}
+
+/*
+ * function that asks fetcha --daemon for frame and prints it,
+ * request is "width height color ppid\n", daemon_env as "NAME=value\n"
+ * and empty line, reply is the frame, daemon closes socket after it
+ * returns 0 on success, -1 if there is no daemon or it didn't answer
+ */
+int
+daemon_frame(void)
+{
+  struct sockaddr_un addr;
+  char req[4096];
+  int term_width, term_height;
+
+  if (daemon_addr(&addr) != 0)
+    return -1;
+
+  get_term_size(&term_width, &term_height);
+  size_t len = snprintf(req, sizeof req, "%d %d %d %d\n", term_width,
+                        term_height, !color_auto || isatty(STDOUT_FILENO),
+                        (int)getppid());
+  int env = env_block(req + len, sizeof req - len);
+  if (env < 0) return -1;
+  len += env;
+  if (len + 1 >= sizeof req) return -1;
+  req[len++] = '\n';
+
+  /* connect to unix socket doesn't wait, it fails if daemon is gone */
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  if (connect(fd, (struct sockaddr *)&addr, sizeof addr) != 0 ||
+      send(fd, req, len, MSG_NOSIGNAL) != (ssize_t)len) {
+    close(fd);
+    return -1;
+  }
+
+  struct timespec now, end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  long long end_ms = end.tv_sec * 1000LL + end.tv_nsec / 1000000 +
+                     daemon_timeout_ms;
+
+  char *frame = NULL;
+  size_t size = 0, cap = 0;
+  for (;;) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long left = end_ms - (now.tv_sec * 1000LL + now.tv_nsec / 1000000);
+    struct pollfd p = { fd, POLLIN, 0 };
+    if (left <= 0 || poll(&p, 1, (int)left) <= 0)
+      break;
+
+    if (size == cap) {
+      char *tmp = realloc(frame, cap = cap ? cap * 2 : 16384);
+      if (!tmp) break;
+      frame = tmp;
+    }
+    ssize_t n = read(fd, frame + size, cap - size);
+    if (n == 0) {
+      /* whole frame is here */
+      close(fd);
+      int ret = size > 0 && fwrite(frame, 1, size, stdout) == size ? 0 : -1;
+      free(frame);
+      return ret;
+    }
+    if (n < 0 && errno != EAGAIN && errno != EINTR)
+      break;
+    if (n > 0) size += n;
+  }
+  close(fd);
+  free(frame);
+  return -1;
+}
+
+/*
+ * function that reads request of client (see daemon_frame()),
+ * sets daemon_env variables of client and renders frame to *frame
+ * values - results of modules, kept between frames
+ * env_of - hash of client environment values[i] was made for
+ * returns 0 on success, -1 on bad request
+ */
+static int
+daemon_render(int fd, struct ascii *art, char **values, uint32_t *env_of,
+              char **frame, size_t *size)
+{
+  char req[4096];
+  size_t len = 0;
+  int term_width, term_height, color, ppid;
+
+  /* request ends with empty line */
+  while (len < sizeof req - 1) {
+    ssize_t n = read(fd, req + len, sizeof req - 1 - len);
+    if (n <= 0) return -1;
+    len += n;
+    req[len] = '\0';
+    if (strstr(req, "\n\n")) break;
+  }
+  char *env = strchr(req, '\n');
+  if (!env || !strstr(req, "\n\n") ||
+      sscanf(req, "%d %d %d %d", &term_width, &term_height, &color,
+             &ppid) != 4)
+    return -1;
+  env++;
+  *strstr(req, "\n\n") = '\0';
+  /* ITEM_ENV modules read parents of client too */
+  uint32_t env_hash = hash_str(env, (uint32_t)ppid);
+  ancestry_from(ppid);
+
+  for (const char **v = daemon_env; *v; v++)
+    unsetenv(*v);
+  char *save;
+  for (char *line = strtok_r(env, "\n", &save); line;
+       line = strtok_r(NULL, "\n", &save)) {
+    char *value = strchr(line, '=');
+    if (!value) continue;
+    *value++ = '\0';
+    for (const char **v = daemon_env; *v; v++)
+      if (!strcmp(*v, line)) setenv(line, value, 1);
+  }
+
+  bool run[config_items_len];
+  size_t maxlen = label_width(config_items, config_items_len);
+  info_list infos = {NULL, 0};
+  visible_items(art, term_width, term_height, run);
+
+  for (size_t i = 0; i < config_items_len; i++) {
+    const info_item *item = &config_items[i];
+    if (!run[i]) {
+      for (int r = 0; r < item_rows(item); r++)
+        add_row(&infos, NULL, NULL, maxlen, false);
+      continue;
+    }
+    if (!values[i] || item->flags & ITEM_LIVE ||
+        (item->flags & ITEM_ENV && env_of[i] != env_hash)) {
+      free(values[i]);
+      values[i] = item->func();
+      if (!values[i]) values[i] = strdup("(null)");
+      env_of[i] = env_hash;
+    }
+    render_value(&infos, item, values[i] ? strdup(values[i]) : NULL, maxlen);
+  }
+
+  if (!(out = open_memstream(frame, size))) {
+    out = stdout;
+    free_info_list(&infos);
+    return -1;
+  }
+  sgr_on = color;
+  sgr_term = sgr_pen = (struct sgr){0};
+  print_fetch(art, &infos, term_width);
+  fclose(out);
+  out = stdout;
+  free_info_list(&infos);
+  return 0;
+}
+
+/*
+ * function that serves frames on daemon socket, one client at a time,
+ * results of modules are kept, ITEM_LIVE modules run for every frame,
+ * ITEM_ENV ones when environment of client changes
+ * returns only on error
+ */
+int
+run_daemon(struct ascii *art)
+{
+  struct sockaddr_un addr;
+  char *values[config_items_len];
+  uint32_t env_of[config_items_len];
+
+  if (daemon_addr(&addr) != 0) {
+    fputs("fetcha: no directory for socket\n", stderr);
+    return -1;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("socket");
+    return -1;
+  }
+  /* socket of dead daemon refuses connections */
+  if (connect(fd, (struct sockaddr *)&addr, sizeof addr) == 0) {
+    fprintf(stderr, "fetcha: daemon is already running on %s\n",
+            addr.sun_path);
+    close(fd);
+    return -1;
+  }
+  unlink(addr.sun_path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof addr) != 0 ||
+      listen(fd, 64) != 0) {
+    perror(addr.sun_path);
+    close(fd);
+    return -1;
+  }
+  chmod(addr.sun_path, 0600);
+  signal(SIGPIPE, SIG_IGN);
+
+  for (size_t i = 0; i < config_items_len; i++) {
+    values[i] = NULL;
+    env_of[i] = 0;
+  }
+
+  for (;;) {
+    int c = accept(fd, NULL, NULL);
+    if (c < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      perror("accept");
+      break;
+    }
+    /* client, that doesn't send request, mustn't block others */
+    struct timeval tv = { 0, 100000 };
+    setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    setsockopt(c, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+
+    char *frame = NULL;
+    size_t size = 0;
+    if (daemon_render(c, art, values, env_of, &frame, &size) == 0) {
+      for (size_t off = 0; off < size; ) {
+        ssize_t n = send(c, frame + off, size - off, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        off += n;
+      }
+    }
+    free(frame);
+    close(c);
+  }
+
+  for (size_t i = 0; i < config_items_len; i++)
+    free(values[i]);
+  close(fd);
+  unlink(addr.sun_path);
+  return -1;
+}
+
+/*
+ * --snapshot file: header, count records, string table,
+ * native byte order (endian tells which), mmap-ed by --diff as is
+ */
+#define SNAP_MAGIC   "FETCHSNP"
+#define SNAP_VERSION 1
+#define SNAP_ENDIAN  0x01020304u
+
+struct snap_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint32_t count;    /* records after header */
+  uint32_t strings;  /* offset of string table */
+  uint32_t size;     /* size of file */
+  uint32_t hash;     /* hash of all records, equal snapshots have same */
+};
+
+struct snap_record
+{
+  uint32_t id;       /* hash of label */
+  uint32_t hash;     /* hash of value */
+  uint32_t label;    /* offsets in string table */
+  uint32_t value;
+};
+
+/* string table, equal strings are stored once */
+typedef struct
+{
+  char *buf;
+  size_t len, cap;
+  uint32_t *offs;
+  size_t count;
+} snap_strings;
+
+static uint32_t
+snap_intern(snap_strings *t, const char *s)
+{
+  size_t len = strlen(s) + 1;
+
+  for (size_t i = 0; i < t->count; i++)
+    if (!strcmp(t->buf + t->offs[i], s))
+      return t->offs[i];
+
+  if (t->len + len > t->cap) {
+    t->cap = (t->len + len) * 2;
+    t->buf = realloc(t->buf, t->cap);
+  }
+  t->offs = realloc(t->offs, sizeof *t->offs * (t->count + 1));
+  if (!t->buf || !t->offs) {
+    fputs("fetcha: out of memory\n", stderr);
+    exit(EXIT_FAILURE);
+  }
+  memcpy(t->buf + t->len, s, len);
+  t->offs[t->count++] = t->len;
+  t->len += len;
+  return t->offs[t->count - 1];
+}
+
+/*
+ * function that runs every module, that isn't ITEM_LIVE, and writes
+ * record per module (and "Header" with user@hostname) to path
+ * returns 0 on success, -1 on error
+ */
+int
+snapshot(const char *path)
+{
+  size_t count = config_items_len + 1;
+  struct snap_record recs[count];
+  struct snap_header h = { SNAP_MAGIC, SNAP_VERSION, SNAP_ENDIAN };
+  snap_strings t = {0};
+  char header[512], hostname[256] = "";
+  const char *name = getenv("USER");
+
+  if (!name) {
+    struct passwd *pw = getpwuid(getuid());
+    name = pw ? pw->pw_name : "unknown";
+  }
+  gethostname(hostname, sizeof hostname - 1);
+  snprintf(header, sizeof header, "%s%s%s", name, header_sep, hostname);
+
+  for (size_t i = 0; i < count; i++) {
+    /* uptime, load, ... differ always, they aren't configuration */
+    if (i && config_items[i - 1].flags & ITEM_LIVE) continue;
+
+    const char *label = i ? config_items[i - 1].label : "Header";
+    char *value = i ? item_run(&config_items[i - 1]) : strdup(header);
+    if (!value) value = strdup("(null)");
+    struct snap_record *r = &recs[h.count++];
+    *r = (struct snap_record){
+      hash_str(label, 0), hash_str(value, 0),
+      snap_intern(&t, label), snap_intern(&t, value)
+    };
+    free(value);
+    h.hash = (h.hash ^ r->id) * 16777619u;
+    h.hash = (h.hash ^ r->hash) * 16777619u;
+  }
+  h.strings = sizeof h + h.count * sizeof *recs;
+  h.size = h.strings + t.len;
+
+  char tmp[4096 + 8];
+  snprintf(tmp, sizeof tmp, "%s.XXXXXX", path);
+  int fd = mkstemp(tmp);
+  int ret = -1;
+  if (fd >= 0) {
+    fchmod(fd, 0644);
+    if (write(fd, &h, sizeof h) == sizeof h &&
+        write(fd, recs, h.count * sizeof *recs) ==
+          (ssize_t)(h.count * sizeof *recs) &&
+        write(fd, t.buf, t.len) == (ssize_t)t.len &&
+        close(fd) == 0 && rename(tmp, path) == 0)
+      ret = 0;
+    else
+      unlink(tmp);
+  }
+  if (ret != 0) perror(path);
+  free(t.buf);
+  free(t.offs);
+  return ret;
+}
+
+/*
+ * function that maps snapshot, checks header and bounds of records
+ * returns header, NULL on error
+ */
+static const struct snap_header *
+snap_map(const char *path)
+{
+  struct stat st;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0 || fstat(fd, &st) != 0 ||
+      st.st_size < (off_t)sizeof(struct snap_header)) {
+    if (fd >= 0) close(fd);
+    fprintf(stderr, "fetcha: %s: not a snapshot\n", path);
+    return NULL;
+  }
+  const struct snap_header *h =
+    mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (h == MAP_FAILED) {
+    perror(path);
+    return NULL;
+  }
+  if (memcmp(h->magic, SNAP_MAGIC, 8) || h->version != SNAP_VERSION ||
+      h->endian != SNAP_ENDIAN || h->size != (uint64_t)st.st_size ||
+      h->strings < sizeof *h || h->strings > h->size ||
+      (h->strings - sizeof *h) % sizeof(struct snap_record) ||
+      h->count > (h->strings - sizeof *h) / sizeof(struct snap_record)) {
+    fprintf(stderr, "fetcha: %s: not a snapshot of this version\n", path);
+    munmap((void *)h, st.st_size);
+    return NULL;
+  }
+  return h;
+}
+
+static void
+snap_unmap(const struct snap_header *h)
+{
+  if (h) munmap((void *)h, h->size);
+}
+
+/*
+ * function that prints string at off of string table, \n as "; "
+ */
+static void
+snap_print(const struct snap_header *h, uint32_t off)
+{
+  size_t table = h->size - h->strings;
+  const char *s, *end = NULL;
+
+  if (off < table) {
+    s = (const char *)h + h->strings + off;
+    end = memchr(s, '\0', table - off);
+  }
+  if (!end) {
+    fputs("(corrupted)", stdout);
+    return;
+  }
+  for (; s < end; s++) {
+    if (*s == '\n')
+      fputs("; ", stdout);
+    else
+      putchar(*s);
+  }
+}
+
+/*
+ * function that compares snapshots by hashes, prints only fields,
+ * that differ: "prefix-label: a", "prefix+label: b",
+ * "prefix label: a -> b"
+ * returns count of different fields
+ */
+int
+snap_diff(const struct snap_header *a, const struct snap_header *b,
+          const char *prefix)
+{
+  const struct snap_record *ra = (const void *)(a + 1);
+  const struct snap_record *rb = (const void *)(b + 1);
+  int diffs = 0;
+
+  if (a->hash == b->hash && a->count == b->count)
+    return 0;
+
+  for (uint32_t i = 0; i < a->count; i++) {
+    uint32_t j = 0;
+    while (j < b->count && rb[j].id != ra[i].id) j++;
+    if (j < b->count && rb[j].hash == ra[i].hash) continue;
+
+    diffs++;
+    printf("%s%c", prefix, j < b->count ? ' ' : '-');
+    snap_print(a, ra[i].label);
+    fputs(": ", stdout);
+    snap_print(a, ra[i].value);
+    if (j < b->count) {
+      fputs(" -> ", stdout);
+      snap_print(b, rb[j].value);
+    }
+    putchar('\n');
+  }
+  for (uint32_t j = 0; j < b->count; j++) {
+    uint32_t i = 0;
+    while (i < a->count && ra[i].id != rb[j].id) i++;
+    if (i < a->count) continue;
+
+    diffs++;
+    printf("%s+", prefix);
+    snap_print(b, rb[j].label);
+    fputs(": ", stdout);
+    snap_print(b, rb[j].value);
+    putchar('\n');
+  }
+  return diffs;
+}
+
+/*
+ * function that compares every snapshot in files (one per line of stdin,
+ * if there are none) with golden, prints differences prefixed by file
+ * returns 0 if all are equal, 1 if some differ, 2 on error (like diff)
+ */
+int
+diff_many(const char *golden, char **files, int count)
+{
+  const struct snap_header *g = snap_map(golden);
+  char line[4096], prefix[4096 + 2];
+  int ret = 0;
+
+  if (!g) return 2;
+  for (int i = 0; count ? i < count : !!fgets(line, sizeof line, stdin);
+       i++) {
+    if (!count) line[strcspn(line, "\n")] = '\0';
+    const char *file = count ? files[i] : line;
+    if (!*file) continue;
+
+    const struct snap_header *h = snap_map(file);
+    if (!h) {
+      ret = 2;
+      continue;
+    }
+    snprintf(prefix, sizeof prefix, "%s: ", file);
+    if (snap_diff(g, h, prefix) && ret == 0)
+      ret = 1;
+    snap_unmap(h);
+  }
+  snap_unmap(g);
+  return ret;
+}
+
+/*
+ * function that runs every module once and prints frame as usual,
+ * reads of modules are captured to bundle (IO_CAPTURE),
+ * or served from it (IO_REPLAY)
+ */
+static int
+capture_replay(int mode, const char *bundle)
+{
+  int term_width, term_height;
+
+  if (io_start(mode, bundle, replay_timing) != 0)
+    return EXIT_FAILURE;
+
+  struct ascii art = get_ascii(false);
+  sgr_on = !color_auto || isatty(STDOUT_FILENO);
+  get_term_size(&term_width, &term_height);
+
+  info_list infos = render_info(config_items, config_items_len, NULL);
+  print_fetch(&art, &infos, term_width);
+  fflush(out);
+
+  free_info_list(&infos);
+  free_ascii(&art);
+  return io_finish() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void
+usage(void)
+{
+  fputs("usage: fetcha [--render-to path | --cat path | --daemon |\n"
+        "              --snapshot file | --diff a b |\n"
+        "              --diff-many golden [file...] |\n"
+        "              --capture bundle | --replay bundle]\n", stderr);
+  exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+  const char *render_path = NULL;
+  const char *cat_path = NULL;
+  const char *bundle = NULL;
+  int bundle_mode = IO_DIRECT;
+  bool daemon = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--render-to") && i + 1 < argc)
+      render_path = argv[++i];
+    else if (!strcmp(argv[i], "--cat") && i + 1 < argc)
+      cat_path = argv[++i];
+    else if (!strcmp(argv[i], "--daemon"))
+      daemon = true;
+    else if ((!strcmp(argv[i], "--capture") || !strcmp(argv[i], "--replay"))
+             && i + 1 < argc) {
+      bundle_mode = argv[i][2] == 'c' ? IO_CAPTURE : IO_REPLAY;
+      bundle = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--snapshot") && i + 1 < argc)
+      return snapshot(argv[i + 1]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    else if (!strcmp(argv[i], "--diff") && i + 2 < argc) {
+      const struct snap_header *a = snap_map(argv[i + 1]);
+      const struct snap_header *b = snap_map(argv[i + 2]);
+      int ret = a && b ? snap_diff(a, b, "") > 0 : 2;
+      snap_unmap(a);
+      snap_unmap(b);
+      return ret;
+    } else if (!strcmp(argv[i], "--diff-many") && i + 1 < argc)
+      return diff_many(argv[i + 1], argv + i + 2, argc - i - 2);
+    else
+      usage();
+  }
+
+  out = stdout;
+
+  /* every module runs here, reads go to (or come from) bundle */
+  if (bundle)
+    return capture_replay(bundle_mode, bundle);
+
+  /* pregenerated frame, if there is no one render it as usual */
+  if (cat_path && cat_frame(cat_path) == 0)
+    return 0;
+
+  /* frame from resident daemon, no modules run here */
+  if (!render_path && !daemon && daemon_client && daemon_frame() == 0)
+    return 0;
+
+  struct ascii art = get_ascii(!render_path && !daemon &&
+                               isatty(STDOUT_FILENO));
+
+  if (daemon) {
+    run_daemon(&art);
+    free_ascii(&art);
+    return EXIT_FAILURE;
+  }
+
+  if (render_path) {
+    info_list infos = render_info(config_items, config_items_len, NULL);
+    int ret = render_to(render_path, &art, &infos);
+    free_info_list(&infos);
+    free_ascii(&art);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  /* strip colors if output isn't a terminal */
+  sgr_on = !color_auto || isatty(STDOUT_FILENO);
+
+  /* layout first, then only modules that will be seen */
+  int term_width, term_height;
+  bool run[config_items_len];
+  get_term_size(&term_width, &term_height);
+  visible_items(&art, term_width, term_height, run);
+
+  if (progressive && isatty(STDOUT_FILENO) && term_height > 0) {
+    print_progressive(&art, run, term_width, term_height);
+    free_ascii(&art);
+    return 0;
+  }
+
+  info_list infos = render_info(config_items, config_items_len, run);
+
+  print_fetch(&art, &infos, term_width);
+
+  free_info_list(&infos);
+  free_ascii(&art);
+  return 0;
 }
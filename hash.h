@@ -0,0 +1,21 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+
+/*
+ * FNV-1a of string, seed is mixed into offset basis,
+ * shared by fetcha and mklogos (perfect hash of logos)
+ */
+static inline uint32_t
+hash_str(const char *s, uint32_t seed)
+{
+  uint32_t h = 2166136261u ^ seed;
+  while (*s) {
+    h ^= (unsigned char)*s++;
+    h *= 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+#endif
@@ -0,0 +1,494 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "hash.h"
+#include "image.h"
+
+#define CACHE_MAGIC "fetcha-image 1"
+#define IMAGE_MAX   16384  /* max width/height of image in pixels */
+#define KITTY_CHUNK 4096   /* max base64 bytes in one kitty escape */
+
+/* decoded image, 8 bit RGBA */
+struct pixels
+{
+  int w, h;
+  unsigned char *rgba;
+};
+
+/* growing output buffer */
+struct buf
+{
+  char *d;
+  size_t len, cap;
+};
+
+static int
+buf_add(struct buf *b, const char *s, size_t n)
+{
+  if (b->len + n > b->cap) {
+    size_t cap = (b->len + n) * 2;
+    char *d = realloc(b->d, cap);
+    if (!d) return -1;
+    b->d = d;
+    b->cap = cap;
+  }
+  memcpy(b->d + b->len, s, n);
+  b->len += n;
+  return 0;
+}
+
+static int
+buf_printf(struct buf *b, const char *fmt, ...)
+{
+  char tmp[128];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(tmp, sizeof tmp, fmt, ap);
+  va_end(ap);
+  return n < 0 ? -1 : buf_add(b, tmp, n);
+}
+
+/*
+ * function that reads whole file
+ * returns malloc-ed content, NULL on error
+ */
+static unsigned char *
+read_all(const char *path, size_t *len)
+{
+  struct stat st;
+  unsigned char *d = NULL;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) return NULL;
+  if (fstat(fd, &st) == 0 && (d = malloc(st.st_size + 1))) {
+    if (read(fd, d, st.st_size) != st.st_size) {
+      free(d);
+      d = NULL;
+    }
+    *len = st.st_size;
+  }
+  close(fd);
+  return d;
+}
+
+static uint32_t
+be32(const unsigned char *p)
+{
+  return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+/*
+ * function that reads width and height from IHDR of PNG
+ * returns 0 on success, -1 if it isn't PNG
+ */
+static int
+png_size(const unsigned char *d, size_t len, int *w, int *h)
+{
+  if (len < 24 || memcmp(d, "\x89PNG\r\n\x1a\n", 8) ||
+      memcmp(d + 12, "IHDR", 4))
+    return -1;
+  *w = be32(d + 16);
+  *h = be32(d + 20);
+  return *w > 0 && *h > 0 && *w <= IMAGE_MAX && *h <= IMAGE_MAX ? 0 : -1;
+}
+
+/*
+ * function that decodes farbfeld (16 bit big endian RGBA)
+ * returns 0 on success, -1 if it isn't farbfeld
+ */
+static int
+decode_farbfeld(const unsigned char *d, size_t len, struct pixels *px)
+{
+  if (len < 16 || memcmp(d, "farbfeld", 8))
+    return -1;
+  px->w = be32(d + 8);
+  px->h = be32(d + 12);
+  if (px->w <= 0 || px->h <= 0 || px->w > IMAGE_MAX || px->h > IMAGE_MAX ||
+      len < 16 + (size_t)px->w * px->h * 8)
+    return -1;
+
+  size_t n = (size_t)px->w * px->h * 4;
+  if (!(px->rgba = malloc(n))) return -1;
+  for (size_t i = 0; i < n; i++)
+    px->rgba[i] = d[16 + i * 2]; /* high byte */
+  return 0;
+}
+
+/*
+ * function that parses number of PPM header, skips white space
+ * and comments before it
+ * returns number, -1 on error
+ */
+static long
+ppm_int(const unsigned char *d, size_t len, size_t *pos)
+{
+  long v = -1;
+
+  while (*pos < len && (d[*pos] == '#' || strchr(" \t\r\n", d[*pos]))) {
+    if (d[*pos] == '#')
+      while (*pos < len && d[*pos] != '\n') (*pos)++;
+    else
+      (*pos)++;
+  }
+  while (*pos < len && d[*pos] >= '0' && d[*pos] <= '9' && v < IMAGE_MAX * 4)
+    v = (v < 0 ? 0 : v * 10) + d[(*pos)++] - '0';
+  return v;
+}
+
+/*
+ * function that decodes binary PPM (P6)
+ * returns 0 on success, -1 if it isn't PPM
+ */
+static int
+decode_ppm(const unsigned char *d, size_t len, struct pixels *px)
+{
+  size_t pos = 2;
+
+  if (len < 2 || memcmp(d, "P6", 2))
+    return -1;
+  px->w = ppm_int(d, len, &pos);
+  px->h = ppm_int(d, len, &pos);
+  long max = ppm_int(d, len, &pos);
+  pos++; /* single white space */
+
+  int bytes = max < 256 ? 1 : 2;
+  if (px->w <= 0 || px->h <= 0 || px->w > IMAGE_MAX || px->h > IMAGE_MAX ||
+      max <= 0 || max > 65535 ||
+      len < pos + (size_t)px->w * px->h * 3 * bytes)
+    return -1;
+
+  size_t n = (size_t)px->w * px->h;
+  if (!(px->rgba = malloc(n * 4))) return -1;
+  for (size_t i = 0; i < n; i++) {
+    for (int c = 0; c < 3; c++) {
+      const unsigned char *s = d + pos + (i * 3 + c) * bytes;
+      long v = bytes == 1 ? s[0] : s[0] << 8 | s[1];
+      px->rgba[i * 4 + c] = v * 255 / max;
+    }
+    px->rgba[i * 4 + 3] = 255;
+  }
+  return 0;
+}
+
+/*
+ * function that scales src to dst->w x dst->h, averaging source pixels
+ * under every target pixel (box filter)
+ * returns 0 on success, -1 on error
+ */
+static int
+scale(const struct pixels *src, struct pixels *dst)
+{
+  if (!(dst->rgba = malloc((size_t)dst->w * dst->h * 4)))
+    return -1;
+
+  for (int y = 0; y < dst->h; y++) {
+    int y0 = (long long)y * src->h / dst->h;
+    int y1 = (long long)(y + 1) * src->h / dst->h;
+    if (y1 <= y0) y1 = y0 + 1;
+    for (int x = 0; x < dst->w; x++) {
+      int x0 = (long long)x * src->w / dst->w;
+      int x1 = (long long)(x + 1) * src->w / dst->w;
+      if (x1 <= x0) x1 = x0 + 1;
+
+      unsigned long sum[4] = {0};
+      for (int sy = y0; sy < y1; sy++)
+        for (int sx = x0; sx < x1; sx++)
+          for (int c = 0; c < 4; c++)
+            sum[c] += src->rgba[((size_t)sy * src->w + sx) * 4 + c];
+      unsigned long n = (unsigned long)(y1 - y0) * (x1 - x0);
+      for (int c = 0; c < 4; c++)
+        dst->rgba[((size_t)y * dst->w + x) * 4 + c] = sum[c] / n;
+    }
+  }
+  return 0;
+}
+
+/*
+ * function that appends kitty graphics escapes showing data at cursor,
+ * cols x rows cells, cursor doesn't move (C=1), no answer (q=2)
+ * format - 100 (PNG) or 32 (RGBA w x h)
+ */
+static int
+encode_kitty(struct buf *b, const unsigned char *data, size_t len,
+             int format, int w, int h, int cols, int rows)
+{
+  static const char tab[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  struct buf enc = {0};
+  int ret = 0;
+
+  for (size_t i = 0; i < len && ret == 0; i += 3) {
+    uint32_t v = data[i] << 16;
+    if (i + 1 < len) v |= data[i + 1] << 8;
+    if (i + 2 < len) v |= data[i + 2];
+    char q[4] = {
+      tab[v >> 18 & 63], tab[v >> 12 & 63],
+      i + 1 < len ? tab[v >> 6 & 63] : '=', i + 2 < len ? tab[v & 63] : '='
+    };
+    ret = buf_add(&enc, q, 4);
+  }
+
+  for (size_t off = 0; off < enc.len && ret == 0; off += KITTY_CHUNK) {
+    size_t n = enc.len - off < KITTY_CHUNK ? enc.len - off : KITTY_CHUNK;
+    int more = off + n < enc.len;
+    if (off == 0) {
+      ret |= buf_printf(b, "\x1b_Ga=T,q=2,C=1,f=%d,c=%d,r=%d,", format,
+                        cols, rows);
+      if (format != 100)
+        ret |= buf_printf(b, "s=%d,v=%d,", w, h);
+      ret |= buf_printf(b, "m=%d;", more);
+    } else {
+      ret |= buf_printf(b, "\x1b_Gm=%d;", more);
+    }
+    ret |= buf_add(b, enc.d + off, n);
+    ret |= buf_add(b, "\x1b\\", 2);
+  }
+  free(enc.d);
+  return ret;
+}
+
+/*
+ * function that appends sixel image of px, colors are rounded
+ * to 6x6x6 cube, pixels with alpha < 128 stay transparent
+ */
+static int
+encode_sixel(struct buf *b, const struct pixels *px)
+{
+  size_t n = (size_t)px->w * px->h;
+  unsigned char *idx = malloc(n);
+  char used[216] = {0};
+  char *line = malloc(px->w);
+  int ret = 0;
+
+  if (!idx || !line) {
+    free(idx);
+    free(line);
+    return -1;
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    const unsigned char *p = px->rgba + i * 4;
+    if (p[3] < 128) {
+      idx[i] = 255;
+      continue;
+    }
+    idx[i] = (p[0] * 5 + 127) / 255 * 36 + (p[1] * 5 + 127) / 255 * 6 +
+             (p[2] * 5 + 127) / 255;
+    used[idx[i]] = 1;
+  }
+
+  /* P2=1: zero bits stay transparent */
+  ret |= buf_printf(b, "\x1bP0;1;0q\"1;1;%d;%d", px->w, px->h);
+  for (int c = 0; c < 216; c++)
+    if (used[c])
+      ret |= buf_printf(b, "#%d;2;%d;%d;%d", c, c / 36 * 20,
+                        c / 6 % 6 * 20, c % 6 * 20);
+
+  for (int y0 = 0; y0 < px->h && ret == 0; y0 += 6) {
+    char band[216] = {0};
+    for (int y = y0; y < y0 + 6 && y < px->h; y++)
+      for (int x = 0; x < px->w; x++)
+        if (idx[(size_t)y * px->w + x] != 255)
+          band[idx[(size_t)y * px->w + x]] = 1;
+
+    int first = 1;
+    for (int c = 0; c < 216; c++) {
+      if (!band[c]) continue;
+      int end = 0;
+      for (int x = 0; x < px->w; x++) {
+        int bits = 0;
+        for (int k = 0; k < 6 && y0 + k < px->h; k++)
+          if (idx[(size_t)(y0 + k) * px->w + x] == c) bits |= 1 << k;
+        line[x] = 63 + bits;
+        if (bits) end = x + 1;
+      }
+
+      /* "$" back to start of band for next color */
+      ret |= buf_printf(b, first ? "#%d" : "$#%d", c);
+      first = 0;
+      for (int x = 0; x < end; ) {
+        int run = 1;
+        while (x + run < end && line[x + run] == line[x]) run++;
+        if (run > 3)
+          ret |= buf_printf(b, "!%d%c", run, line[x]);
+        else
+          ret |= buf_add(b, line + x, run);
+        x += run;
+      }
+    }
+    ret |= buf_add(b, "-", 1);
+  }
+  ret |= buf_add(b, "\x1b\\", 2);
+
+  free(idx);
+  free(line);
+  return ret;
+}
+
+/*
+ * function that encodes image at path, cols cells wide,
+ * cell_w x cell_h pixels per cell
+ * returns 0 and payload in b, height in *rows, -1 on error
+ */
+static int
+encode(const char *path, int protocol, int cols, int cell_w, int cell_h,
+       int *rows, struct buf *b)
+{
+  struct pixels src = {0}, dst = {0};
+  size_t len;
+  int ret = -1;
+  unsigned char *d = read_all(path, &len);
+
+  if (!d) return -1;
+
+  if (png_size(d, len, &src.w, &src.h) == 0) {
+    /* PNG is passed to kitty as is, there is no decoder */
+    *rows = ((long long)cols * cell_w * src.h / src.w + cell_h - 1) / cell_h;
+    if (*rows < 1) *rows = 1;
+    if (protocol == IMAGE_KITTY)
+      ret = encode_kitty(b, d, len, 100, 0, 0, cols, *rows);
+    free(d);
+    return ret;
+  }
+
+  if (decode_farbfeld(d, len, &src) != 0 && decode_ppm(d, len, &src) != 0) {
+    free(d);
+    return -1;
+  }
+  free(d);
+
+  dst.w = cols * cell_w;
+  dst.h = (long long)dst.w * src.h / src.w;
+  if (dst.h < 1) dst.h = 1;
+  *rows = (dst.h + cell_h - 1) / cell_h;
+
+  if (scale(&src, &dst) == 0) {
+    if (protocol == IMAGE_KITTY)
+      ret = encode_kitty(b, dst.rgba, (size_t)dst.w * dst.h * 4, 32,
+                         dst.w, dst.h, cols, *rows);
+    else
+      ret = encode_sixel(b, &dst);
+  }
+  free(src.rgba);
+  free(dst.rgba);
+  return ret;
+}
+
+/*
+ * function that returns directory for cached payloads,
+ * $XDG_CACHE_HOME/fetcha or ~/.cache/fetcha, created if needed
+ * returns 0 on success, -1 on error
+ */
+static int
+cache_dir(char *buf, size_t size)
+{
+  const char *cache = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+
+  if (cache && *cache)
+    snprintf(buf, size, "%s", cache);
+  else if (home && *home)
+    snprintf(buf, size, "%s/.cache", home);
+  else
+    return -1;
+
+  if (mkdir(buf, 0700) != 0 && errno != EEXIST)
+    return -1;
+  size_t len = strlen(buf);
+  if ((size_t)snprintf(buf + len, size - len, "/fetcha") >= size - len ||
+      (mkdir(buf, 0700) != 0 && errno != EEXIST))
+    return -1;
+  return 0;
+}
+
+/*
+ * function that returns protocol to use, IMAGE_AUTO is kitty on
+ * terminals known to support it, IMAGE_NONE otherwise
+ */
+int
+image_detect(int protocol)
+{
+  const char *term = getenv("TERM");
+  const char *prog = getenv("TERM_PROGRAM");
+
+  if (protocol != IMAGE_AUTO)
+    return protocol;
+  if (getenv("KITTY_WINDOW_ID") ||
+      (term && (!strcmp(term, "xterm-kitty") ||
+                !strcmp(term, "xterm-ghostty"))) ||
+      (prog && (!strcmp(prog, "WezTerm") || !strcmp(prog, "ghostty"))))
+    return IMAGE_KITTY;
+  return IMAGE_NONE;
+}
+
+/*
+ * function that opens payload drawing image at path, cols cells wide,
+ * from cache, it is encoded and cached first, if there is none for
+ * (image, its mtime and size, protocol, cols, cell size),
+ * cache file is "fetcha-image 1 rows\n" and payload
+ * returns fd, payload is len bytes at off, its height is *rows cells,
+ * -1 on error
+ */
+int
+image_open(const char *path, int protocol, int cols, int cell_w,
+           int cell_h, int *rows, off_t *off, off_t *len)
+{
+  char key[4096 + 128], file[4096 + 32], head[64];
+  struct stat st;
+
+  if (!path || protocol == IMAGE_NONE || cols <= 0 || cell_w <= 0 ||
+      cell_h <= 0 || stat(path, &st) != 0 || cache_dir(file, 4096) != 0)
+    return -1;
+
+  snprintf(key, sizeof key, "%s|%lld.%ld|%lld|%d|%d|%dx%d", path,
+           (long long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec,
+           (long long)st.st_size, protocol, cols, cell_w, cell_h);
+  size_t n = strlen(file);
+  snprintf(file + n, sizeof file - n, "/img.%08x%08x",
+           hash_str(key, 0), hash_str(key, 0x9e3779b9u));
+
+  for (int pass = 0; pass < 2; pass++) {
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+      ssize_t got = pread(fd, head, sizeof head - 1, 0);
+      head[got > 0 ? got : 0] = '\0';
+      char *nl = strchr(head, '\n');
+      if (nl && !strncmp(head, CACHE_MAGIC " ", sizeof CACHE_MAGIC) &&
+          sscanf(head + sizeof CACHE_MAGIC, "%d", rows) == 1 &&
+          fstat(fd, &st) == 0) {
+        *off = nl + 1 - head;
+        *len = st.st_size - *off;
+        return fd;
+      }
+      close(fd);
+    }
+    if (pass) break;
+
+    /* not cached yet */
+    struct buf b = {0};
+    char tmp[sizeof file + 8];
+    if (encode(path, protocol, cols, cell_w, cell_h, rows, &b) != 0) {
+      free(b.d);
+      return -1;
+    }
+    snprintf(head, sizeof head, CACHE_MAGIC " %d\n", *rows);
+    snprintf(tmp, sizeof tmp, "%s.XXXXXX", file);
+    int out = mkstemp(tmp);
+    if (out >= 0) {
+      size_t hl = strlen(head);
+      if (write(out, head, hl) != (ssize_t)hl ||
+          write(out, b.d, b.len) != (ssize_t)b.len || close(out) != 0 ||
+          rename(tmp, file) != 0)
+        unlink(tmp);
+    }
+    free(b.d);
+  }
+  return -1;
+}
@@ -0,0 +1,18 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <sys/types.h>
+
+/* terminal graphics protocols of image logo */
+enum {
+  IMAGE_NONE,
+  IMAGE_AUTO,   /* kitty, if terminal is known to support it */
+  IMAGE_KITTY,
+  IMAGE_SIXEL,
+};
+
+int image_detect(int protocol);
+int image_open(const char *path, int protocol, int cols, int cell_w,
+               int cell_h, int *rows, off_t *off, off_t *len);
+
+#endif
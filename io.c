@@ -0,0 +1,728 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "hash.h"
+
+/*
+ * bundle: header, then count records, each is struct io_record,
+ * key (NUL terminated) and data, padded to 8 bytes,
+ * native byte order (endian tells which), mmap-ed by --replay as is
+ */
+#define IO_MAGIC   "FETCHCAP"
+#define IO_VERSION 1
+#define IO_ENDIAN  0x01020304u
+
+struct io_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint32_t count;    /* records after header */
+  uint32_t reserved;
+  uint64_t size;     /* size of file */
+};
+
+/* record types */
+enum {
+  REC_FILE   = 'F',  /* contents of file */
+  REC_EXISTS = 'E',  /* file or directory exists */
+  REC_DIR    = 'D',  /* names in directory, NUL separated */
+  REC_LINK   = 'L',  /* target of symlink */
+  REC_CMD    = 'P',  /* output of command */
+  REC_VALUE  = 'V',  /* io_record() */
+};
+
+struct io_record
+{
+  uint32_t type;
+  uint32_t key_len;  /* with NUL */
+  uint64_t len;
+  uint64_t time_ns;  /* how long it took on captured host */
+};
+
+/*
+ * record in memory, reads of the same key are chained in order,
+ * replay serves them one after another, the last one repeats
+ */
+typedef struct
+{
+  int type;
+  const char *key;
+  const char *data;
+  size_t len;
+  uint64_t time_ns;
+  uint32_t next;     /* next read of key, index + 1 */
+  uint32_t cur;      /* first entry: next read to serve, index + 1 */
+} io_entry;
+
+struct io_dir
+{
+  DIR *d;            /* IO_DIRECT */
+  const char *next;  /* names of recorded listing */
+  const char *end;
+};
+
+static int  mode = IO_DIRECT;
+static bool replay_timing;
+static const char *bundle_path;
+static void  *bundle_map;
+static size_t bundle_size;
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static io_entry *entries;
+static size_t entries_count, entries_cap;
+static uint32_t *slots;  /* open addressing, first entry of key, index + 1 */
+static size_t slots_size;
+
+/* directories opened by io_open_dir(), keys are made of their paths */
+static struct { int fd; char path[1024]; } dirs[16];
+
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/*
+ * function that returns slot of key, empty one if it isn't there,
+ * io_lock is held
+ */
+static uint32_t *
+io_slot(int type, const char *key)
+{
+  size_t mask = slots_size - 1;
+  for (size_t i = hash_str(key, type) & mask; ; i = (i + 1) & mask) {
+    io_entry *e = slots[i] ? &entries[slots[i] - 1] : NULL;
+    if (!e || (e->type == type && !strcmp(e->key, key)))
+      return &slots[i];
+  }
+}
+
+/*
+ * function that appends entry, chained after reads of the same key,
+ * io_lock is held
+ * returns 0 on success, -1 if there is no memory
+ */
+static int
+io_add(io_entry e)
+{
+  if ((entries_count + 1) * 2 > slots_size) {
+    size_t old = slots_size;
+    uint32_t *old_slots = slots;
+    slots_size = old ? old * 2 : 256;
+    if (!(slots = calloc(slots_size, sizeof *slots))) {
+      slots = old_slots;
+      slots_size = old;
+      return -1;
+    }
+    for (size_t i = 0; i < old; i++)
+      if (old_slots[i]) {
+        io_entry *o = &entries[old_slots[i] - 1];
+        *io_slot(o->type, o->key) = old_slots[i];
+      }
+    free(old_slots);
+  }
+  if (entries_count == entries_cap) {
+    size_t cap = entries_cap ? entries_cap * 2 : 128;
+    io_entry *n = realloc(entries, cap * sizeof *n);
+    if (!n) return -1;
+    entries = n;
+    entries_cap = cap;
+  }
+
+  uint32_t idx = entries_count + 1;
+  uint32_t *slot = io_slot(e.type, e.key);
+  e.next = 0;
+  e.cur = idx;
+  entries[entries_count++] = e;
+  if (!*slot) {
+    *slot = idx;
+    return 0;
+  }
+  io_entry *tail = &entries[*slot - 1];
+  while (tail->next) tail = &entries[tail->next - 1];
+  tail->next = idx;
+  return 0;
+}
+
+/*
+ * function that stores read of key (IO_CAPTURE), data is taken over,
+ * copy of the entry is put to res
+ * returns 0 on success, -1 on error
+ */
+static int
+io_put(int type, const char *key, char *data, size_t len, uint64_t time_ns,
+       io_entry *res)
+{
+  io_entry e = { type, strdup(key), data, len, time_ns, 0, 0 };
+  int ret = -1;
+
+  pthread_mutex_lock(&io_lock);
+  if (e.key && io_add(e) == 0) {
+    *res = e;
+    ret = 0;
+  }
+  pthread_mutex_unlock(&io_lock);
+  if (ret != 0) {
+    free((char *)e.key);
+    free(data);
+  }
+  return ret;
+}
+
+/*
+ * function that serves the next read of key (IO_REPLAY) to res,
+ * waits as long as it took, if replay_timing
+ * returns 0 on success, -1 if it wasn't captured
+ */
+static int
+io_get(int type, const char *key, io_entry *res)
+{
+  int ret = -1;
+
+  pthread_mutex_lock(&io_lock);
+  uint32_t *slot = slots_size ? io_slot(type, key) : NULL;
+  if (slot && *slot) {
+    io_entry *first = &entries[*slot - 1];
+    *res = entries[first->cur - 1];
+    if (res->next) first->cur = res->next;
+    ret = 0;
+  }
+  pthread_mutex_unlock(&io_lock);
+
+  if (ret != 0) {
+    errno = ENOENT;
+    return -1;
+  }
+  if (replay_timing && res->time_ns) {
+    struct timespec ts = { res->time_ns / 1000000000u,
+                           res->time_ns % 1000000000u };
+    nanosleep(&ts, NULL);
+  }
+  return 0;
+}
+
+/*
+ * function that reads fd to the end to malloc buffer
+ * returns NULL on error
+ */
+static char *
+read_all(int fd, size_t *len)
+{
+  size_t cap = 4096, n = 0;
+  char *buf = malloc(cap);
+  ssize_t r;
+
+  while (buf && (r = read(fd, buf + n, cap - n)) != 0) {
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      free(buf);
+      return NULL;
+    }
+    n += r;
+    if (n == cap) {
+      char *b = realloc(buf, cap *= 2);
+      if (!b) free(buf);
+      buf = b;
+    }
+  }
+  *len = n;
+  return buf;
+}
+
+/*
+ * function that makes key of dir/path: full path, if dir was opened by
+ * io_open_dir() (or is known to kernel), else path
+ */
+static const char *
+io_key(int dir, const char *path, char *buf, size_t size)
+{
+  char link[64], target[1024];
+
+  if (dir == AT_FDCWD || path[0] == '/') return path;
+  for (size_t i = 0; i < sizeof dirs / sizeof dirs[0]; i++)
+    if (dirs[i].path[0] && dirs[i].fd == dir) {
+      snprintf(buf, size, "%s/%s", dirs[i].path, path);
+      return buf;
+    }
+  snprintf(link, sizeof link, "/proc/self/fd/%d", dir);
+  ssize_t n = readlink(link, target, sizeof target - 1);
+  if (n <= 0) return path;
+  target[n] = '\0';
+  snprintf(buf, size, "%s/%s", target, path);
+  return buf;
+}
+
+/*
+ * function that makes stream of entry data
+ */
+static FILE *
+io_memfile(const io_entry *e)
+{
+  if (!e->len) return fopen("/dev/null", "r");
+  return fmemopen((void *)e->data, e->len, "r");
+}
+
+/*
+ * function that reads whole dir/path to entry of key (IO_CAPTURE)
+ * returns 0 on success, -1 if it can't be read
+ */
+static int
+capture_file(int dir, const char *path, const char *key, io_entry *res)
+{
+  uint64_t start = now_ns();
+  size_t len;
+  int fd = openat(dir, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  char *data = read_all(fd, &len);
+  close(fd);
+  if (!data) return -1;
+  return io_put(REC_FILE, key, data, len, now_ns() - start, res);
+}
+
+/*
+ * function that loads bundle for replay
+ * returns 0 on success, -1 if it isn't a bundle
+ */
+static int
+io_load(const char *path)
+{
+  struct stat st;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0 || fstat(fd, &st) != 0 ||
+      st.st_size < (off_t)sizeof(struct io_header)) {
+    if (fd >= 0) close(fd);
+    fprintf(stderr, "fetcha: %s: not a capture bundle\n", path);
+    return -1;
+  }
+  bundle_size = st.st_size;
+  bundle_map = mmap(NULL, bundle_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (bundle_map == MAP_FAILED) {
+    perror(path);
+    return -1;
+  }
+
+  const struct io_header *h = bundle_map;
+  if (memcmp(h->magic, IO_MAGIC, 8) || h->version != IO_VERSION ||
+      h->endian != IO_ENDIAN || h->size != bundle_size)
+    goto bad;
+
+  size_t off = sizeof *h;
+  for (uint32_t i = 0; i < h->count; i++) {
+    const struct io_record *r = (const void *)((char *)bundle_map + off);
+    if (bundle_size - off < sizeof *r) goto bad;
+    off += sizeof *r;
+    if (!r->key_len || bundle_size - off < r->key_len ||
+        bundle_size - off - r->key_len < r->len)
+      goto bad;
+    const char *key = (char *)bundle_map + off;
+    if (key[r->key_len - 1] != '\0') goto bad;
+    io_entry e = { r->type, key, key + r->key_len, r->len, r->time_ns, 0, 0 };
+    if (io_add(e) != 0) goto bad;
+    off += (r->key_len + r->len + 7) & ~(size_t)7;
+    if (off > bundle_size) goto bad;
+  }
+  return 0;
+
+bad:
+  fprintf(stderr, "fetcha: %s: not a capture bundle of this version\n", path);
+  return -1;
+}
+
+/*
+ * function that starts capture to bundle or replay from it,
+ * timing - replay waits as long as captured reads took
+ * returns 0 on success, -1 on error
+ */
+int
+io_start(int m, const char *bundle, bool timing)
+{
+  mode = m;
+  bundle_path = bundle;
+  replay_timing = timing;
+  return mode == IO_REPLAY ? io_load(bundle) : 0;
+}
+
+/*
+ * function that writes captured reads to bundle, to temporary file
+ * renamed then
+ * returns 0 on success, -1 on error
+ */
+int
+io_finish(void)
+{
+  char tmp[4096 + 8];
+  static const char pad[8];
+
+  if (mode != IO_CAPTURE) return 0;
+
+  struct io_header h = { IO_MAGIC, IO_VERSION, IO_ENDIAN, entries_count, 0,
+                         sizeof h };
+  for (size_t i = 0; i < entries_count; i++)
+    h.size += sizeof(struct io_record) +
+              ((strlen(entries[i].key) + 1 + entries[i].len + 7) & ~7u);
+
+  snprintf(tmp, sizeof tmp, "%s.XXXXXX", bundle_path);
+  int fd = mkstemp(tmp);
+  FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+  if (!f) {
+    perror(tmp);
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+  fchmod(fd, 0644);
+
+  fwrite(&h, sizeof h, 1, f);
+  for (size_t i = 0; i < entries_count; i++) {
+    io_entry *e = &entries[i];
+    struct io_record r = { e->type, strlen(e->key) + 1, e->len, e->time_ns };
+    fwrite(&r, sizeof r, 1, f);
+    fwrite(e->key, 1, r.key_len, f);
+    fwrite(e->data, 1, e->len, f);
+    fwrite(pad, 1, -(r.key_len + e->len) & 7, f);
+  }
+
+  int err = ferror(f);
+  if (fclose(f) != 0 || err || rename(tmp, bundle_path) != 0) {
+    perror(bundle_path);
+    unlink(tmp);
+    return -1;
+  }
+  return 0;
+}
+
+int
+io_mode(void)
+{
+  return mode;
+}
+
+/*
+ * function that opens file for reading
+ */
+FILE *
+io_fopen(const char *path)
+{
+  io_entry e;
+
+  if (mode == IO_DIRECT) return fopen(path, "r");
+  if (mode == IO_CAPTURE ? capture_file(AT_FDCWD, path, path, &e)
+                         : io_get(REC_FILE, path, &e))
+    return NULL;
+  return io_memfile(&e);
+}
+
+/*
+ * function that reads small file dir/path to buf, NUL terminated
+ * returns length, -1 on error
+ */
+ssize_t
+io_read_at(int dir, const char *path, char *buf, size_t size)
+{
+  char key_buf[4096];
+  io_entry e;
+
+  if (mode == IO_DIRECT) {
+    int fd = openat(dir, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return n;
+  }
+
+  const char *key = io_key(dir, path, key_buf, sizeof key_buf);
+  if (mode == IO_CAPTURE ? capture_file(dir, path, key, &e)
+                         : io_get(REC_FILE, key, &e))
+    return -1;
+  size_t n = e.len < size - 1 ? e.len : size - 1;
+  memcpy(buf, e.data, n);
+  buf[n] = '\0';
+  return n;
+}
+
+/*
+ * function that reads target of symlink dir/path, not NUL terminated
+ * (as readlinkat(2))
+ */
+ssize_t
+io_readlink_at(int dir, const char *path, char *buf, size_t size)
+{
+  char key_buf[4096];
+  io_entry e;
+
+  if (mode == IO_DIRECT) return readlinkat(dir, path, buf, size);
+
+  const char *key = io_key(dir, path, key_buf, sizeof key_buf);
+  if (mode == IO_CAPTURE) {
+    char target[4096];
+    uint64_t start = now_ns();
+    ssize_t n = readlinkat(dir, path, target, sizeof target);
+    char *data = n >= 0 ? malloc(n + 1) : NULL;
+    if (!data) return -1;
+    memcpy(data, target, n);
+    if (io_put(REC_LINK, key, data, n, now_ns() - start, &e) != 0)
+      return -1;
+  } else if (io_get(REC_LINK, key, &e) != 0) {
+    return -1;
+  }
+  size_t n = e.len < size ? e.len : size;
+  memcpy(buf, e.data, n);
+  return n;
+}
+
+/*
+ * function that maps whole file to memory (read only),
+ * unmap it with io_unmap()
+ * returns NULL on error or if it is empty
+ */
+const void *
+io_map(const char *path, size_t *len)
+{
+  io_entry e;
+
+  if (mode == IO_DIRECT) {
+    struct stat st;
+    void *p = MAP_FAILED;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+      p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+    *len = st.st_size;
+    return p;
+  }
+  if (mode == IO_CAPTURE ? capture_file(AT_FDCWD, path, path, &e)
+                         : io_get(REC_FILE, path, &e))
+    return NULL;
+  *len = e.len;
+  return e.len ? e.data : NULL;
+}
+
+void
+io_unmap(const void *p, size_t len)
+{
+  if (mode == IO_DIRECT && p) munmap((void *)p, len);
+}
+
+/*
+ * function that returns 0 if path exists, -1 otherwise
+ */
+int
+io_access(const char *path)
+{
+  io_entry e;
+
+  if (mode == IO_REPLAY) return io_get(REC_EXISTS, path, &e);
+  if (access(path, F_OK) != 0) return -1;
+  if (mode == IO_CAPTURE) io_put(REC_EXISTS, path, NULL, 0, 0, &e);
+  return 0;
+}
+
+/*
+ * function that opens directory dir/path for io_read_at() and
+ * io_readlink_at() in it, close it with io_close_dir()
+ * returns fd, -1 on error
+ */
+int
+io_open_dir(int dir, const char *path)
+{
+  char key_buf[4096];
+  const char *key = io_key(dir, path, key_buf, sizeof key_buf);
+  io_entry e;
+  int fd;
+
+  if (mode == IO_REPLAY)
+    fd = io_get(REC_EXISTS, key, &e) == 0 ?
+         open("/dev/null", O_RDONLY | O_CLOEXEC) : -1;
+  else
+    fd = openat(dir, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0 || mode == IO_DIRECT) return fd;
+
+  if (mode == IO_CAPTURE) io_put(REC_EXISTS, key, NULL, 0, 0, &e);
+  pthread_mutex_lock(&io_lock);
+  for (size_t i = 0; i < sizeof dirs / sizeof dirs[0]; i++)
+    if (!dirs[i].path[0]) {
+      dirs[i].fd = fd;
+      snprintf(dirs[i].path, sizeof dirs[i].path, "%s", key);
+      break;
+    }
+  pthread_mutex_unlock(&io_lock);
+  return fd;
+}
+
+void
+io_close_dir(int fd)
+{
+  pthread_mutex_lock(&io_lock);
+  for (size_t i = 0; i < sizeof dirs / sizeof dirs[0]; i++)
+    if (dirs[i].path[0] && dirs[i].fd == fd) dirs[i].path[0] = '\0';
+  pthread_mutex_unlock(&io_lock);
+  close(fd);
+}
+
+/*
+ * function that opens directory for listing with io_readdir()
+ * returns NULL on error
+ */
+io_dir *
+io_opendir(const char *path)
+{
+  io_dir *d = calloc(1, sizeof *d);
+  io_entry e;
+
+  if (!d) return NULL;
+  if (mode == IO_DIRECT) {
+    if ((d->d = opendir(path))) return d;
+    free(d);
+    return NULL;
+  }
+
+  if (mode == IO_CAPTURE) {
+    uint64_t start = now_ns();
+    DIR *dir = opendir(path);
+    struct dirent *de;
+    size_t len = 0, cap = 4096;
+    char *names = dir ? malloc(cap) : NULL;
+    while (names && (de = readdir(dir))) {
+      size_t n = strlen(de->d_name) + 1;
+      if (len + n > cap) {
+        char *b = realloc(names, cap = (cap + n) * 2);
+        if (!b) free(names);
+        names = b;
+      }
+      if (names) memcpy(names + len, de->d_name, n);
+      len += n;
+    }
+    if (dir) closedir(dir);
+    if (!names ||
+        io_put(REC_DIR, path, names, len, now_ns() - start, &e) != 0) {
+      free(d);
+      return NULL;
+    }
+  } else if (io_get(REC_DIR, path, &e) != 0) {
+    free(d);
+    return NULL;
+  }
+  d->next = e.data;
+  d->end = e.data + e.len;
+  return d;
+}
+
+/*
+ * function that returns next name in directory, NULL at the end
+ */
+const char *
+io_readdir(io_dir *d)
+{
+  if (d->d) {
+    struct dirent *e = readdir(d->d);
+    return e ? e->d_name : NULL;
+  }
+  if (d->next >= d->end) return NULL;
+  const char *name = d->next;
+  d->next += strlen(name) + 1;
+  return name;
+}
+
+void
+io_closedir(io_dir *d)
+{
+  if (!d) return;
+  if (d->d) closedir(d->d);
+  free(d);
+}
+
+/*
+ * function that runs command and returns stream of its output,
+ * close it with io_pclose()
+ */
+FILE *
+io_popen(const char *cmd)
+{
+  io_entry e;
+
+  if (mode == IO_DIRECT) return popen(cmd, "r");
+  if (mode == IO_CAPTURE) {
+    uint64_t start = now_ns();
+    size_t len;
+    FILE *f = popen(cmd, "r");
+    if (!f) return NULL;
+    char *data = read_all(fileno(f), &len);
+    pclose(f);
+    if (!data || io_put(REC_CMD, cmd, data, len, now_ns() - start, &e) != 0)
+      return NULL;
+  } else if (io_get(REC_CMD, cmd, &e) != 0) {
+    return NULL;
+  }
+  return io_memfile(&e);
+}
+
+int
+io_pclose(FILE *f)
+{
+  return mode == IO_DIRECT ? pclose(f) : fclose(f);
+}
+
+/*
+ * function that copies captured value of key to data (IO_REPLAY),
+ * for inputs, that aren't files (cpuid, results of X11)
+ * returns 0 on success, -1 if there is none
+ */
+int
+io_value(const char *key, void *data, size_t size)
+{
+  io_entry e;
+
+  if (mode != IO_REPLAY || io_get(REC_VALUE, key, &e) != 0) return -1;
+  memcpy(data, e.data, e.len < size ? e.len : size);
+  return 0;
+}
+
+/*
+ * function that captures value of key (IO_CAPTURE)
+ */
+void
+io_record(const char *key, const void *data, size_t size)
+{
+  io_entry e;
+  char *copy;
+
+  if (mode != IO_CAPTURE || !(copy = malloc(size ? size : 1))) return;
+  memcpy(copy, data, size);
+  io_put(REC_VALUE, key, copy, size, 0, &e);
+}
+
+int
+io_uname(struct utsname *u)
+{
+  if (io_value("uname", u, sizeof *u) == 0) return 0;
+  int ret = uname(u);
+  if (ret == 0) io_record("uname", u, sizeof *u);
+  return ret;
+}
+
+pid_t
+io_getppid(void)
+{
+  pid_t ppid;
+  if (io_value("getppid", &ppid, sizeof ppid) == 0) return ppid;
+  ppid = getppid();
+  io_record("getppid", &ppid, sizeof ppid);
+  return ppid;
+}
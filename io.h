@@ -0,0 +1,44 @@
+#ifndef IO_H
+#define IO_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/utsname.h>
+
+/*
+ * I/O of modules: files, directories, links and output of commands
+ * go through these, --capture records every read to a bundle,
+ * --replay serves them from it
+ */
+enum {
+  IO_DIRECT,
+  IO_CAPTURE,
+  IO_REPLAY,
+};
+
+typedef struct io_dir io_dir;
+
+int  io_start(int mode, const char *bundle, bool timing);
+int  io_finish(void);
+int  io_mode(void);
+
+FILE   *io_fopen(const char *path);
+ssize_t io_read_at(int dir, const char *path, char *buf, size_t size);
+ssize_t io_readlink_at(int dir, const char *path, char *buf, size_t size);
+int     io_access(const char *path);
+const void *io_map(const char *path, size_t *len);
+void    io_unmap(const void *p, size_t len);
+int     io_open_dir(int dir, const char *path);
+void    io_close_dir(int fd);
+io_dir *io_opendir(const char *path);
+const char *io_readdir(io_dir *d);
+void    io_closedir(io_dir *d);
+FILE   *io_popen(const char *cmd);
+int     io_pclose(FILE *f);
+int     io_value(const char *key, void *data, size_t size);
+void    io_record(const char *key, const void *data, size_t size);
+int     io_uname(struct utsname *u);
+pid_t   io_getppid(void);
+
+#endif
@@ -0,0 +1,153 @@
+/* generated by mklogos, do not edit */
+
+#define LOGO_SEED  13u
+#define LOGO_SLOTS 64
+
+static const unsigned char logo_data[] = {
+  0xf0, 0x06, 0x24, 0x34, 0x20, 0x20, 0x20, 0x2f, 0x5c, 0x20, 0x2f, 0x5c,
+  0x0a, 0x20, 0x20, 0x2f, 0x2f, 0x20, 0x5c, 0x20, 0x20, 0x5c, 0x0a, 0x09,
+  0x00, 0x12, 0x20, 0x0b, 0x00, 0x11, 0x2f, 0x0b, 0x00, 0x04, 0x0c, 0x00,
+  0x00, 0x0b, 0x00, 0x03, 0x19, 0x00, 0xb0, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x5c, 0x0a, 0x1e, 0x20, 0x01, 0x00, 0x6e, 0x24,
+  0x31, 0x2d, 0x60, 0x20, 0x0a, 0x19, 0x00, 0x4e, 0x2e, 0x6f, 0x2b, 0x60,
+  0x17, 0x00, 0x5d, 0x60, 0x6f, 0x6f, 0x6f, 0x2f, 0x2e, 0x00, 0x7c, 0x60,
+  0x2b, 0x6f, 0x6f, 0x6f, 0x6f, 0x3a, 0x46, 0x00, 0x02, 0x17, 0x00, 0x0f,
+  0x19, 0x00, 0x00, 0x13, 0x2d, 0x19, 0x00, 0x1b, 0x2b, 0x33, 0x00, 0x61,
+  0x60, 0x2f, 0x3a, 0x2d, 0x3a, 0x2b, 0x4d, 0x00, 0x0b, 0x1b, 0x00, 0x81,
+  0x24, 0x33, 0x60, 0x2f, 0x2b, 0x2b, 0x2b, 0x2b, 0x05, 0x00, 0x2a, 0x2b,
+  0x2b, 0x39, 0x00, 0x02, 0x1b, 0x00, 0x06, 0x04, 0x00, 0x08, 0x89, 0x00,
+  0x01, 0x37, 0x00, 0x22, 0x24, 0x31, 0x89, 0x00, 0x03, 0x06, 0x00, 0x17,
+  0x2f, 0xd9, 0x00, 0xc1, 0x2e, 0x2f, 0x6f, 0x6f, 0x6f, 0x73, 0x73, 0x73,
+  0x73, 0x6f, 0x2b, 0x2b, 0x08, 0x00, 0x00, 0x0a, 0x00, 0x06, 0xf9, 0x00,
+  0x12, 0x2e, 0x1d, 0x00, 0x83, 0x73, 0x6f, 0x2d, 0x60, 0x60, 0x60, 0x60,
+  0x2f, 0x22, 0x00, 0x06, 0x1a, 0x01, 0x14, 0x2d, 0x34, 0x00, 0x12, 0x2e,
+  0x5b, 0x01, 0x12, 0x3a, 0x43, 0x00, 0x33, 0x73, 0x6f, 0x2e, 0x53, 0x01,
+  0x13, 0x3a, 0x55, 0x00, 0x24, 0x73, 0x2f, 0x7c, 0x01, 0x04, 0x6e, 0x00,
+  0x23, 0x2b, 0x2e, 0x77, 0x01, 0x04, 0x56, 0x00, 0x07, 0x24, 0x00, 0x11,
+  0x2b, 0x92, 0x00, 0x51, 0x6f, 0x6f, 0x2f, 0x2d, 0x20, 0x9c, 0x01, 0x04,
+  0x7a, 0x00, 0x55, 0x6f, 0x2b, 0x2f, 0x3a, 0x2d, 0x46, 0x01, 0x22, 0x3a,
+  0x2f, 0xb3, 0x00, 0x20, 0x6f, 0x2b, 0x14, 0x00, 0x10, 0x0a, 0x88, 0x01,
+  0x00, 0xc8, 0x00, 0x3e, 0x3a, 0x2d, 0x60, 0xb8, 0x01, 0x20, 0x2e, 0x2d,
+  0x2d, 0x00, 0x21, 0x6f, 0x3a, 0x02, 0x02, 0x63, 0x0a, 0x20, 0x60, 0x2b,
+  0x2b, 0x3a, 0xb3, 0x00, 0x0f, 0x06, 0x00, 0x02, 0x40, 0x60, 0x2d, 0x2f,
+  0x2b, 0xb2, 0x00, 0x3e, 0x0a, 0x20, 0x2e, 0x4d, 0x00, 0x0c, 0x46, 0x02,
+  0x50, 0x60, 0x2f, 0x20, 0x20, 0x0a, 0xc0, 0x24, 0x32, 0x20, 0x5f, 0x5f,
+  0x5f, 0x5f, 0x24, 0x33, 0x5e, 0x24, 0x35, 0x09, 0x00, 0xf1, 0x02, 0x0a,
+  0x24, 0x32, 0x20, 0x7c, 0x5c, 0x20, 0x20, 0x24, 0x33, 0x7c, 0x24, 0x35,
+  0x20, 0x20, 0x2f, 0x7c, 0x11, 0x00, 0x23, 0x20, 0x5c, 0x11, 0x00, 0xc0,
+  0x2f, 0x20, 0x7c, 0x0a, 0x3c, 0x2d, 0x2d, 0x2d, 0x2d, 0x20, 0x24, 0x34,
+  0x07, 0x00, 0xf1, 0x09, 0x3e, 0x0a, 0x20, 0x7c, 0x20, 0x2f, 0x20, 0x24,
+  0x32, 0x7c, 0x24, 0x33, 0x20, 0x5c, 0x20, 0x7c, 0x0a, 0x24, 0x34, 0x20,
+  0x7c, 0x2f, 0x5f, 0x5f, 0x11, 0x00, 0xe0, 0x5f, 0x5f, 0x5c, 0x7c, 0x0a,
+  0x24, 0x32, 0x20, 0x20, 0x20, 0x20, 0x20, 0x76, 0x0a, 0x50, 0x24, 0x31,
+  0x20, 0x20, 0x5f, 0x01, 0x00, 0x30, 0x0a, 0x20, 0x2f, 0x0a, 0x00, 0x50,
+  0x20, 0x5c, 0x0a, 0x7c, 0x20, 0x0b, 0x00, 0x30, 0x20, 0x20, 0x7c, 0x0a,
+  0x00, 0xf0, 0x00, 0x5c, 0x5f, 0x5f, 0x5f, 0x2d, 0x0a, 0x2d, 0x5f, 0x0a,
+  0x20, 0x20, 0x2d, 0x2d, 0x5f, 0x0a, 0x31, 0x24, 0x34, 0x20, 0x01, 0x00,
+  0x10, 0x5f, 0x01, 0x00, 0x11, 0x0a, 0x0c, 0x00, 0x11, 0x2f, 0x0f, 0x00,
+  0x53, 0x29, 0x24, 0x37, 0x5c, 0x0a, 0x1e, 0x00, 0x11, 0x7c, 0x15, 0x00,
+  0x42, 0x24, 0x37, 0x5c, 0x20, 0x13, 0x00, 0xe0, 0x5f, 0x5f, 0x5f, 0x7c,
+  0x20, 0x20, 0x7c, 0x5f, 0x5f, 0x24, 0x37, 0x2f, 0x20, 0x2f, 0x26, 0x00,
+  0x61, 0x2f, 0x20, 0x24, 0x37, 0x28, 0x5f, 0x49, 0x00, 0x20, 0x29, 0x5f,
+  0x12, 0x00, 0x12, 0x2f, 0x32, 0x00, 0x00, 0x27, 0x00, 0x82, 0x0a, 0x24,
+  0x34, 0x5c, 0x20, 0x5c, 0x5f, 0x5f, 0x11, 0x00, 0x00, 0x54, 0x00, 0xb0,
+  0x5c, 0x24, 0x37, 0x28, 0x5f, 0x5f, 0x5f, 0x5f, 0x5f, 0x2f, 0x0a, 0x50,
+  0x24, 0x35, 0x20, 0x5f, 0x2d, 0x01, 0x00, 0x42, 0x5f, 0x0a, 0x28, 0x20,
+  0x01, 0x00, 0x30, 0x5c, 0x0a, 0x5c, 0x0a, 0x00, 0x11, 0x30, 0x0b, 0x00,
+  0x31, 0x24, 0x37, 0x20, 0x0e, 0x00, 0x00, 0x1c, 0x00, 0x42, 0x29, 0x0a,
+  0x20, 0x2f, 0x24, 0x00, 0x23, 0x5f, 0x2f, 0x2e, 0x00, 0xa0, 0x5f, 0x2d,
+  0x0a, 0x5c, 0x5f, 0x5f, 0x5f, 0x5f, 0x2d, 0x0a, 0xf1, 0x03, 0x24, 0x34,
+  0x2d, 0x23, 0x2e, 0x20, 0x23, 0x0a, 0x20, 0x40, 0x23, 0x23, 0x23, 0x0a,
+  0x20, 0x20, 0x2d, 0x23, 0x01, 0x00, 0x20, 0x0a, 0x20, 0x01, 0x00, 0x00,
+  0x14, 0x00, 0x07, 0x10, 0x00, 0x76, 0x3d, 0x23, 0x23, 0x2e, 0x20, 0x20,
+  0x2e, 0x21, 0x00, 0x21, 0x23, 0x23, 0x27, 0x00, 0x00, 0x08, 0x00, 0x0b,
+  0x12, 0x00, 0x01, 0x13, 0x00, 0x0a, 0x12, 0x00, 0x53, 0x40, 0x20, 0x20,
+  0x20, 0x2e, 0x37, 0x00, 0x02, 0x5f, 0x00, 0x03, 0x67, 0x00, 0x50, 0x20,
+  0x20, 0x20, 0x23, 0x0a, 0x46, 0x24, 0x32, 0x20, 0x5f, 0x01, 0x00, 0x45,
+  0x0a, 0x7c, 0x5f, 0x20, 0x01, 0x00, 0x92, 0x5c, 0x0a, 0x20, 0x20, 0x7c,
+  0x20, 0x24, 0x37, 0x7c, 0x22, 0x00, 0x45, 0x20, 0x24, 0x32, 0x7c, 0x12,
+  0x00, 0x02, 0x02, 0x00, 0x0f, 0x12, 0x00, 0x09, 0x11, 0x5c, 0x57, 0x00,
+  0x13, 0x2f, 0x36, 0x00, 0x02, 0x0e, 0x00, 0x60, 0x5f, 0x5f, 0x5f, 0x5f,
+  0x2f, 0x0a, 0x34, 0x24, 0x32, 0x7c, 0x01, 0x00, 0x10, 0x20, 0x0a, 0x00,
+  0x1f, 0x0a, 0x0f, 0x00, 0x00, 0x11, 0x20, 0x01, 0x00, 0x06, 0x0f, 0x00,
+  0x0b, 0x1e, 0x00, 0x0f, 0x0f, 0x00, 0x10, 0x50, 0x7c, 0x7c, 0x7c, 0x7c,
+  0x0a, 0x61, 0x24, 0x34, 0x20, 0x20, 0x5c, 0x5c, 0x04, 0x00, 0xd1, 0x2f,
+  0x2f, 0x0a, 0x20, 0x3d, 0x3d, 0x5c, 0x5c, 0x5f, 0x5f, 0x5c, 0x5c, 0x2f,
+  0x0e, 0x00, 0x50, 0x20, 0x20, 0x2f, 0x2f, 0x20, 0x20, 0x00, 0x51, 0x2f,
+  0x2f, 0x0a, 0x3d, 0x3d, 0x0c, 0x00, 0x00, 0x13, 0x00, 0x60, 0x3d, 0x3d,
+  0x0a, 0x20, 0x2f, 0x2f, 0x29, 0x00, 0x82, 0x5f, 0x2f, 0x2f, 0x0a, 0x2f,
+  0x2f, 0x20, 0x2f, 0x42, 0x00, 0x00, 0x18, 0x00, 0xb0, 0x20, 0x2f, 0x2f,
+  0x20, 0x5c, 0x5c, 0x20, 0x20, 0x5c, 0x5c, 0x0a, 0x52, 0x24, 0x32, 0x20,
+  0x20, 0x5f, 0x01, 0x00, 0x50, 0x0a, 0x5f, 0x5f, 0x7c, 0x20, 0x0e, 0x00,
+  0x40, 0x20, 0x5c, 0x0a, 0x20, 0x01, 0x00, 0x44, 0x2f, 0x20, 0x2e, 0x5c,
+  0x0c, 0x00, 0x60, 0x5c, 0x5f, 0x5f, 0x2f, 0x20, 0x7c, 0x18, 0x00, 0x03,
+  0x2e, 0x00, 0x01, 0x0c, 0x00, 0x16, 0x5c, 0x3b, 0x00, 0xa0, 0x5f, 0x5f,
+  0x5f, 0x5f, 0x5f, 0x5f, 0x5f, 0x5f, 0x2f, 0x0a, 0x31, 0x24, 0x36, 0x5f,
+  0x01, 0x00, 0x70, 0x0a, 0x5c, 0x20, 0x20, 0x20, 0x5f, 0x20, 0x06, 0x00,
+  0x01, 0x03, 0x00, 0x53, 0x5f, 0x5f, 0x0a, 0x20, 0x5c, 0x02, 0x00, 0x01,
+  0x14, 0x00, 0x50, 0x2f, 0x20, 0x2f, 0x0a, 0x20, 0x13, 0x00, 0x13, 0x5f,
+  0x13, 0x00, 0x02, 0x11, 0x00, 0x00, 0x32, 0x00, 0x81, 0x5f, 0x5f, 0x5f,
+  0x5c, 0x20, 0x20, 0x2f, 0x5f, 0x10, 0x00, 0x04, 0x32, 0x00, 0x10, 0x5f,
+  0x1d, 0x00, 0xa0, 0x5f, 0x5f, 0x5c, 0x5f, 0x5c, 0x5f, 0x5f, 0x28, 0x5f,
+  0x29, 0x0f, 0x00, 0x12, 0x28, 0x6b, 0x00, 0x80, 0x5f, 0x5f, 0x5f, 0x5f,
+  0x5f, 0x29, 0x60, 0x0a, 0x31, 0x24, 0x31, 0x20, 0x01, 0x00, 0x81, 0x2e,
+  0x4d, 0x2e, 0x3a, 0x4d, 0x4d, 0x4d, 0x0a, 0x0e, 0x00, 0x15, 0x4d, 0x01,
+  0x00, 0x11, 0x2e, 0x11, 0x00, 0x16, 0x2c, 0x11, 0x00, 0x67, 0x4d, 0x0a,
+  0x20, 0x2e, 0x4d, 0x4d, 0x22, 0x00, 0x20, 0x4d, 0x0a, 0x2e, 0x00, 0x08,
+  0x35, 0x00, 0x01, 0x11, 0x00, 0x01, 0x13, 0x00, 0x04, 0x03, 0x00, 0x00,
+  0x58, 0x00, 0x05, 0x54, 0x00, 0x01, 0x70, 0x00, 0x01, 0x52, 0x00, 0x00,
+  0x6d, 0x00, 0x07, 0x5a, 0x00, 0x01, 0x76, 0x00, 0x12, 0x3a, 0x82, 0x00,
+  0x24, 0x20, 0x60, 0x84, 0x00, 0x50, 0x4d, 0x4d, 0x4d, 0x4d, 0x0a, 0xa4,
+  0x24, 0x32, 0x20, 0x20, 0x20, 0x20, 0x60, 0x2d, 0x2f, 0x2b, 0x01, 0x00,
+  0x85, 0x2f, 0x2d, 0x2e, 0x60, 0x0a, 0x20, 0x60, 0x2d, 0x11, 0x00, 0x04,
+  0x1a, 0x00, 0x4d, 0x2d, 0x60, 0x0a, 0x2e, 0x15, 0x00, 0x00, 0x37, 0x00,
+  0x2e, 0x2e, 0x0a, 0x2d, 0x00, 0x04, 0x1a, 0x00, 0x0b, 0x46, 0x00, 0x15,
+  0x2f, 0x69, 0x00, 0x0a, 0x1a, 0x00, 0x62, 0x2f, 0x2e, 0x20, 0x20, 0x20,
+  0x2e, 0x85, 0x00, 0x08, 0x34, 0x00, 0x01, 0x18, 0x00, 0x00, 0xa2, 0x00,
+  0x01, 0x1c, 0x00, 0x06, 0x68, 0x00, 0x03, 0x18, 0x00, 0x12, 0x60, 0x1c,
+  0x00, 0x43, 0x3a, 0x2b, 0x0a, 0x20, 0x9b, 0x00, 0x03, 0x31, 0x00, 0x31,
+  0x2e, 0x3a, 0x2d, 0x3a, 0x00, 0x30, 0x60, 0x2e, 0x0a, 0xde, 0x00, 0x06,
+  0x31, 0x00, 0x00, 0xd7, 0x00, 0x42, 0x2f, 0x2d, 0x60, 0x0a, 0x3f, 0x00,
+  0x03, 0x5e, 0x00, 0xb0, 0x60, 0x2f, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2f,
+  0x2d, 0x60, 0x0a, 0x63, 0x24, 0x34, 0x20, 0x20, 0x20, 0x5f, 0x01, 0x00,
+  0x44, 0x0a, 0x20, 0x20, 0x2f, 0x0e, 0x00, 0x75, 0x7c, 0x0a, 0x20, 0x20,
+  0x7c, 0x20, 0x7c, 0x19, 0x00, 0x12, 0x5c, 0x25, 0x00, 0x45, 0x20, 0x20,
+  0x5c, 0x0a, 0x32, 0x00, 0x45, 0x7c, 0x20, 0x7c, 0x0a, 0x24, 0x00, 0x45,
+  0x5f, 0x5f, 0x2f, 0x0a, 0x0b, 0x00, 0x50, 0x5f, 0x5f, 0x5f, 0x5f, 0x0a,
+  0x34, 0x24, 0x31, 0x20, 0x01, 0x00, 0x21, 0x5f, 0x0a, 0x0b, 0x00, 0xa1,
+  0x2d, 0x2d, 0x2d, 0x28, 0x5f, 0x29, 0x0a, 0x20, 0x5f, 0x2f, 0x0c, 0x00,
+  0xf2, 0x02, 0x20, 0x20, 0x5c, 0x0a, 0x28, 0x5f, 0x29, 0x20, 0x7c, 0x20,
+  0x20, 0x20, 0x7c, 0x0a, 0x20, 0x20, 0x5c, 0x16, 0x00, 0x24, 0x5f, 0x2f,
+  0x2e, 0x00, 0x50, 0x2d, 0x28, 0x5f, 0x29, 0x0a, 0x72, 0x24, 0x32, 0x20,
+  0x20, 0x20, 0x20, 0x5f, 0x01, 0x00, 0x52, 0x0a, 0x20, 0x5f, 0x20, 0x5c,
+  0x0c, 0x00, 0x61, 0x20, 0x2d, 0x0a, 0x7c, 0x20, 0x5c, 0x1a, 0x00, 0xc1,
+  0x20, 0x20, 0x5c, 0x20, 0x7c, 0x0a, 0x7c, 0x20, 0x7c, 0x20, 0x2f, 0x20,
+  0x0c, 0x00, 0x03, 0x0e, 0x00, 0x00, 0x2a, 0x00, 0x13, 0x2f, 0x0e, 0x00,
+  0x04, 0x36, 0x00, 0xf0, 0x00, 0x5c, 0x5f, 0x7c, 0x0a, 0x20, 0x2d, 0x5f,
+  0x5f, 0x5f, 0x5f, 0x5f, 0x5f, 0x5f, 0x5c, 0x0a,
+};
+
+static const struct {
+  const char *id;
+  unsigned int off;  /* in logo_data */
+  unsigned int zlen; /* compressed size */
+  unsigned int len;  /* decompressed size */
+} logos[LOGO_SLOTS] = {
+  [35] = { "alpine", 0, 54, 68 },
+  [53] = { "arch", 54, 276, 603 },
+  [21] = { "centos", 330, 99, 106 },
+  [46] = { "debian", 429, 45, 47 },
+  [41] = { "fedora", 474, 101, 128 },
+  [12] = { "gentoo", 575, 57, 73 },
+  [11] = { "kali", 632, 80, 136 },
+  [17] = { "linuxmint", 712, 58, 115 },
+  [3] = { "manjaro", 770, 35, 107 },
+  [25] = { "nixos", 805, 79, 91 },
+  [61] = { "opensuse", 884, 60, 83 },
+  [34] = { "pop", 944, 92, 123 },
+  [58] = { "rhel", 1036, 91, 166 },
+  [49] = { "rocky", 1127, 136, 272 },
+  [27] = { "slackware", 1263, 57, 92 },
+  [43] = { "ubuntu", 1320, 56, 71 },
+  [20] = { "void", 1376, 72, 94 },
+};
@@ -0,0 +1,181 @@
+/*
+ * mklogos - generates logos.h from logos/<id>.txt
+ *
+ * every logo is compressed to LZ4 block format and stored in one table,
+ * indexed by perfect hash of os-release ID (the file name),
+ * so fetcha decompresses only the selected one.
+ *
+ * usage: mklogos logos/<id>.txt... > logos.h
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+
+#define MIN_MATCH 4
+#define MAX_OFF   65535
+
+typedef struct {
+  char id[64];
+  unsigned char *data;
+  size_t len;
+  unsigned char *z;
+  size_t zlen;
+} logo;
+
+static void
+die(const char *msg)
+{
+  perror(msg);
+  exit(1);
+}
+
+static unsigned char *
+slurp(const char *path, size_t *len)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f) die(path);
+  unsigned char *buf = NULL;
+  size_t n;
+  *len = 0;
+  do {
+    buf = realloc(buf, *len + 4096);
+    if (!buf) die("realloc");
+    n = fread(buf + *len, 1, 4096, f);
+    *len += n;
+  } while (n > 0);
+  fclose(f);
+  return buf;
+}
+
+static void
+put_len(unsigned char *z, size_t *o, size_t n)
+{
+  while (n >= 255) {
+    z[(*o)++] = 255;
+    n -= 255;
+  }
+  z[(*o)++] = (unsigned char)n;
+}
+
+static void
+put_seq(unsigned char *z, size_t *o, const unsigned char *lit, size_t nlit,
+        size_t off, size_t mlen)
+{
+  size_t m = mlen ? mlen - MIN_MATCH : 0;
+  z[(*o)++] = (unsigned char)((nlit < 15 ? nlit : 15) << 4 | (m < 15 ? m : 15));
+  if (nlit >= 15) put_len(z, o, nlit - 15);
+  memcpy(z + *o, lit, nlit);
+  *o += nlit;
+  if (!mlen) return;
+  z[(*o)++] = off & 0xff;
+  z[(*o)++] = off >> 8;
+  if (m >= 15) put_len(z, o, m - 15);
+}
+
+/*
+ * greedy LZ4 block compression, longest match by brute force
+ * (logos are small), last 5 bytes are always literals and
+ * no match starts in last 12 bytes, as the format requires
+ */
+static unsigned char *
+lz4_compress(const unsigned char *s, size_t n, size_t *zlen)
+{
+  unsigned char *z = malloc(n + n / 255 + 16);
+  size_t o = 0, i = 0, anchor = 0;
+  if (!z) die("malloc");
+
+  while (n >= 12 && i + 12 <= n) {
+    size_t best = 0, best_off = 0;
+    for (size_t j = (i > MAX_OFF ? i - MAX_OFF : 0); j < i; j++) {
+      size_t l = 0;
+      while (i + l < n - 5 && s[j + l] == s[i + l]) l++;
+      if (l > best) {
+        best = l;
+        best_off = i - j;
+      }
+    }
+    if (best < MIN_MATCH) {
+      i++;
+      continue;
+    }
+    put_seq(z, &o, s + anchor, i - anchor, best_off, best);
+    i += best;
+    anchor = i;
+  }
+  put_seq(z, &o, s + anchor, n - anchor, 0, 0);
+  *zlen = o;
+  return z;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n = argc - 1;
+  logo *logos = calloc(n, sizeof *logos);
+  if (!logos || n < 1) {
+    fputs("usage: mklogos logos/<id>.txt...\n", stderr);
+    return 1;
+  }
+
+  for (int i = 0; i < n; i++) {
+    const char *base = strrchr(argv[i + 1], '/');
+    base = base ? base + 1 : argv[i + 1];
+    snprintf(logos[i].id, sizeof logos[i].id, "%.*s",
+             (int)strcspn(base, "."), base);
+    logos[i].data = slurp(argv[i + 1], &logos[i].len);
+    logos[i].z = lz4_compress(logos[i].data, logos[i].len, &logos[i].zlen);
+  }
+
+  /* perfect hash: smallest seed without collisions in 2n slots */
+  uint32_t slots = 1, seed;
+  while (slots < 2u * n) slots <<= 1;
+  int *slot_of = malloc(n * sizeof *slot_of);
+  char *used = malloc(slots);
+  if (!slot_of || !used) die("malloc");
+  for (seed = 0; ; seed++) {
+    int ok = 1;
+    memset(used, 0, slots);
+    for (int i = 0; i < n && ok; i++) {
+      slot_of[i] = hash_str(logos[i].id, seed) & (slots - 1);
+      ok = !used[slot_of[i]];
+      used[slot_of[i]] = 1;
+    }
+    if (ok) break;
+  }
+
+  printf("/* generated by mklogos, do not edit */\n\n");
+  printf("#define LOGO_SEED  %uu\n", seed);
+  printf("#define LOGO_SLOTS %u\n\n", slots);
+  printf("static const unsigned char logo_data[] = {");
+  size_t off = 0;
+  for (int i = 0; i < n; i++) {
+    for (size_t k = 0; k < logos[i].zlen; k++)
+      printf("%s0x%02x,", (off + k) % 12 ? " " : "\n  ", logos[i].z[k]);
+    off += logos[i].zlen;
+  }
+  printf("\n};\n\n");
+
+  printf("static const struct {\n"
+         "  const char *id;\n"
+         "  unsigned int off;  /* in logo_data */\n"
+         "  unsigned int zlen; /* compressed size */\n"
+         "  unsigned int len;  /* decompressed size */\n"
+         "} logos[LOGO_SLOTS] = {\n");
+  off = 0;
+  for (int i = 0; i < n; i++) {
+    printf("  [%d] = { \"%s\", %zu, %zu, %zu },\n", slot_of[i], logos[i].id,
+           off, logos[i].zlen, logos[i].len);
+    off += logos[i].zlen;
+  }
+  printf("};\n");
+
+  size_t raw = 0;
+  for (int i = 0; i < n; i++) raw += logos[i].len;
+  fprintf(stderr, "mklogos: %d logos, %zu -> %zu bytes, seed %u\n",
+          n, raw, off, seed);
+  return 0;
+}
@@ -5,34 +5,73 @@
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <termios.h>
+#include <poll.h>
+#include <utmp.h>
+#include <linux/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
+
+#include "modules.h"
+#include "hash.h"
+#include "io.h"
 
-/* void function placeholder */
-typedef char *(*info_func_t)(void);
 
-/* info */
-typedef struct 
+/*
+ * function that copies os-release value to out,
+ * without quotes and newline
+ */
+static void
+os_release_value(const char *val, char *out, size_t size)
 {
-  const char *label;
-  info_func_t func;
-} info_item;
-
+  size_t len = strcspn(val, "\n");
+  if (len >= 2 && (*val == '"' || *val == '\'') && val[len - 1] == *val) {
+    val++;
+    len -= 2;
+  }
+  snprintf(out, size, "%.*s", (int)len, val);
+}
 
-static char *
-read_file_trim(const char *path)
+/*
+ * function that returns os-release fields,
+ * file is parsed only once, fields that are missing are empty
+ */
+const struct os_release *
+os_release(void)
 {
-  FILE *f = fopen(path, "r");
-  if (!f) {
-    return strdup("unknown");
-  }
-  char buf[256];
-  if (!fgets(buf, sizeof buf, f)) {
-    fclose(f);
-    return strdup("unknown");
+  static struct os_release rel;
+  static int parsed = 0;
+  if (parsed) return &rel;
+  parsed = 1;
+
+  FILE *f = io_fopen("/etc/os-release");
+  if (!f) f = io_fopen("/usr/lib/os-release");
+  if (!f) return &rel;
+
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, "PRETTY_NAME=", 12) == 0)
+      os_release_value(line + 12, rel.pretty_name, sizeof rel.pretty_name);
+    else if (strncmp(line, "ID=", 3) == 0)
+      os_release_value(line + 3, rel.id, sizeof rel.id);
+    else if (strncmp(line, "ID_LIKE=", 8) == 0)
+      os_release_value(line + 8, rel.id_like, sizeof rel.id_like);
   }
-  /* trim newline */
-  size_t n = strlen(buf);
-  while (n && (buf[n-1] == '\n' || buf[n-1] == '\r')) buf[--n] = '\0';
-  return strdup(buf);
+  fclose(f);
+  return &rel;
 }
 
 /* 
@@ -41,29 +80,12 @@ read_file_trim(const char *path)
 char *
 get_os(void)
 {
-  FILE *f = fopen("/etc/os-release", "r");
-  if (!f) f = fopen("/usr/lib/os-release", "r");
-  char osname[128] = "Unknown";
-  if (f) {
-    char line[256];
-    while (fgets(line, sizeof(line), f)) {
-      if (strncmp(line, "PRETTY_NAME=", 12) == 0) {
-        char *val = line + 12;
-        val[strcspn(val, "\n")] = 0;
-        if (*val == '"' && val[strlen(val)-1] == '"') {
-          val[strlen(val)-1] = 0;
-          val++;
-        }
-        strncpy(osname, val, sizeof(osname)-1);
-        break;
-      }
-    }
-    fclose(f);
-  }
+  const struct os_release *rel = os_release();
+  const char *osname = rel->pretty_name[0] ? rel->pretty_name : "Unknown";
 
   /* uname for arch */
   struct utsname buf;
-  if (uname(&buf) != 0) {
+  if (io_uname(&buf) != 0) {
     return strdup("unknown");
   }
 
@@ -78,38 +100,53 @@ get_os(void)
 }
 
 
+/*
+ * /sys/class/dmi/id files, read once for get_host and get_virt
+ */
+enum { DMI_VENDOR, DMI_PRODUCT, DMI_VERSION };
+
+static const char *dmi_files[] = {
+  "/sys/class/dmi/id/sys_vendor",
+  "/sys/class/dmi/id/product_name",
+  "/sys/class/dmi/id/product_version",
+};
+static char dmi_values[3][128];
+static bool dmi_done;
+static pthread_mutex_t dmi_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * function that returns DMI field, NULL if it is empty or there is no DMI
+ * (microVMs, most ARM boards)
+ */
+static const char *
+dmi(int field)
+{
+  pthread_mutex_lock(&dmi_lock);
+  for (int i = 0; !dmi_done && i < 3; i++) {
+    char *v = dmi_values[i];
+    ssize_t n = io_read_at(AT_FDCWD, dmi_files[i], v, sizeof dmi_values[i]);
+    while (n > 0 && (v[n - 1] == '\n' || v[n - 1] == ' ')) v[--n] = '\0';
+    if (n < 0) v[0] = '\0';
+  }
+  dmi_done = true;
+  pthread_mutex_unlock(&dmi_lock);
+  return dmi_values[field][0] ? dmi_values[field] : NULL;
+}
+
 /*
  * function that returns malloc string "Product Version" or NULL
  */
 char *
 get_host(void)
 {
-  char *product = read_file_trim("/sys/class/dmi/id/product_name");
-  char *version = read_file_trim("/sys/class/dmi/id/product_version");
-  if (!product && !version) {
-    free(product);
-    free(version);
-    return strdup("unknown");
-  }
-  if (!version) version = strdup("");
-  size_t len = strlen(product ? product : "") + 1 + strlen(version) + 1 + 8;
-  char *out = malloc(len);
-  if (!out) {
-    free(product);
-    free(version);
-    return strdup("unknown");
-  }
-  if(product && version[0]) 
-    snprintf(out, len, "%s %s", product, version);
-  else if (product)
-    snprintf(out, len, "%s", product);
-  else    
-    snprintf(out, len, "%s", version);
-
-  free(product);
-  free(version);
+  const char *product = dmi(DMI_PRODUCT);
+  const char *version = dmi(DMI_VERSION);
+  char buf[256];
 
-  return out;
+  if (!product && !version) return strdup("unknown");
+  snprintf(buf, sizeof buf, "%s%s%s", product ? product : "",
+           product && version ? " " : "", version ? version : "");
+  return strdup(buf);
 }
 
 
@@ -120,7 +157,7 @@ char *
 get_kernel(void)
 {
   struct utsname buf;
-  if (uname(&buf) != 0) {
+  if (io_uname(&buf) != 0) {
     return strdup("unknown");
   }
   return strdup(buf.release);
@@ -181,7 +218,7 @@ format_uptime(int years, int months, int weeks, int days, int hours, int mins)
 char *
 get_uptime(void)
 {
-	FILE *f = fopen("/proc/uptime", "r");
+	FILE *f = io_fopen("/proc/uptime");
 	double seconds;
 	long long total_seconds;
 	long long total_days;
@@ -212,51 +249,724 @@ get_uptime(void)
 }
 
 
+/* Boot Loader Interface variables (systemd-boot sets them) */
+#define EFI_VARS "/sys/firmware/efi/efivars"
+#define LOADER_GUID "4a67b082-0a4c-41cf-b6c7-440b29bb8c4f"
+
+/*
+ * function that reads time of loader EFI variable name: 4 bytes of
+ * attributes, then UTF-16 decimal number (us since firmware started)
+ * returns it, -1 if there is no such variable
+ */
+static long long
+loader_time_us(const char *name)
+{
+  char path[256], buf[128];
+  long long us = 0;
+  ssize_t i;
+
+  snprintf(path, sizeof path, EFI_VARS "/%s-" LOADER_GUID, name);
+  ssize_t n = io_read_at(AT_FDCWD, path, buf, sizeof buf);
+  for (i = 4; i + 1 < n && buf[i] >= '0' && buf[i] <= '9' && !buf[i + 1];
+       i += 2)
+    us = us * 10 + buf[i] - '0';
+  return i > 4 ? us : -1;
+}
+
+/*
+ * function that returns wall clock time of boot (ns): btime of /proc/stat
+ * is CLOCK_REALTIME - CLOCK_BOOTTIME in whole seconds, clocks give the rest
+ * returns -1 on error
+ */
+static long long
+boot_wall_ns(void)
+{
+  char line[256];
+  long long btime = -1, ns;
+
+  FILE *f = io_fopen("/proc/stat");
+  if (!f) return -1;
+  while (fgets(line, sizeof line, f))
+    if (!strncmp(line, "btime ", 6)) {
+      btime = strtoll(line + 6, NULL, 10);
+      break;
+    }
+  fclose(f);
+  if (btime < 0) return -1;
+
+  if (io_value("boot_ns", &ns, sizeof ns) == 0) return ns;
+  if (io_mode() == IO_REPLAY) return btime * 1000000000LL;
+  struct timespec real, boot;
+  clock_gettime(CLOCK_REALTIME, &real);
+  clock_gettime(CLOCK_BOOTTIME, &boot);
+  ns = (real.tv_sec - boot.tv_sec) * 1000000000LL + real.tv_nsec - boot.tv_nsec;
+  if (ns / 1000000000LL < btime - 1 || ns / 1000000000LL > btime + 1)
+    ns = btime * 1000000000LL;
+  io_record("boot_ns", &ns, sizeof ns);
+  return ns;
+}
+
+/*
+ * function that returns birth time (wall clock ns) of /run/systemd,
+ * systemd makes it on tmpfs as soon as it starts (in initrd, if any)
+ * returns -1 if it's unknown
+ */
+static long long
+systemd_start_ns(void)
+{
+  struct statx st;
+  long long ns = -1;
+
+  /* statx can't be captured, its result is */
+  if (io_value("systemd_start", &ns, sizeof ns) == 0) return ns;
+  if (io_mode() == IO_REPLAY) return -1;
+  if (syscall(SYS_statx, AT_FDCWD, "/run/systemd", 0, STATX_BTIME, &st) == 0
+      && st.stx_mask & STATX_BTIME)
+    ns = st.stx_btime.tv_sec * 1000000000LL + st.stx_btime.tv_nsec;
+  io_record("systemd_start", &ns, sizeof ns);
+  return ns;
+}
+
+/*
+ * function that returns time (wall clock ns) of first RUN_LVL record of
+ * utmp since boot, init reached its runlevel (systemd-update-utmp writes
+ * it when default target is reached)
+ * returns -1 if there is none
+ */
+static long long
+runlevel_ns(long long boot)
+{
+  size_t len = 0;
+  long long ns = -1;
+
+  const struct utmp *ut = io_map("/var/run/utmp", &len);
+  for (size_t i = 0; ut && i < len / sizeof *ut; i++) {
+    long long t = ut[i].ut_tv.tv_sec * 1000000000LL +
+                  ut[i].ut_tv.tv_usec * 1000LL;
+    if (ut[i].ut_type == RUN_LVL && t >= boot && (ns < 0 || t < ns))
+      ns = t;
+  }
+  io_unmap(ut, len);
+  return ns;
+}
+
+/*
+ * function that returns "firmware, loader, kernel, userspace = total"
+ * (the ones known), as systemd-analyze without asking systemd:
+ * firmware and loader from EFI variables of loader, kernel ends when
+ * systemd makes /run/systemd, userspace at RUN_LVL record of utmp,
+ * boot date, if none is known
+ */
 char *
-get_memory(void) {
-  char *buf = malloc(64);
-  FILE *f = fopen("/proc/meminfo", "r");
-  if (!f) {
+get_boot(void)
+{
+  char buf[160];
+  size_t len = 0;
+  long long init = loader_time_us("LoaderTimeInitUSec");
+  long long exec = loader_time_us("LoaderTimeExecUSec");
+  long long boot = boot_wall_ns();
+  if (boot < 0) return strdup("unknown");
+  long long start = systemd_start_ns();
+  long long done = runlevel_ns(boot);
+
+  /* /run/systemd of other boot (not tmpfs) */
+  if (start < boot || (done >= 0 && start > done)) start = -1;
+  if (exec < init) exec = -1;
+
+  if (init >= 0)
+    len += snprintf(buf + len, sizeof buf - len, "firmware %.1fs",
+                    init / 1e6);
+  /* without LoaderTimeInitUSec exec covers firmware too */
+  if (exec >= 0 && init >= 0)
+    len += snprintf(buf + len, sizeof buf - len, ", loader %.1fs",
+                    (exec - init) / 1e6);
+  else if (exec >= 0)
+    len += snprintf(buf + len, sizeof buf - len, "firmware+loader %.1fs",
+                    exec / 1e6);
+  if (start >= 0)
+    len += snprintf(buf + len, sizeof buf - len, "%skernel %.1fs",
+                    len ? ", " : "", (start - boot) / 1e9);
+  if (done >= 0)
+    len += snprintf(buf + len, sizeof buf - len, "%s%s %.1fs = %.1fs",
+                    len ? ", " : "", start >= 0 ? "userspace" : "kernel+userspace",
+                    (done - (start >= 0 ? start : boot)) / 1e9,
+                    (done - boot) / 1e9 + (exec >= 0 ? exec / 1e6 : 0));
+  if (len) return strdup(buf);
+
+  struct tm tm;
+  time_t t = boot / 1000000000LL;
+  if (!localtime_r(&t, &tm) || !strftime(buf, sizeof buf,
+                                         "booted %Y-%m-%d %H:%M", &tm))
     return strdup("unknown");
+  return strdup(buf);
+}
+
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+
+/*
+ * function that finds cgroup v2 directory of fetcha
+ * ("0::" line of /proc/self/cgroup), -1 if there is no unified hierarchy
+ */
+static int
+cgroup_path(char *buf, size_t size)
+{
+  char cg[4096];
+  if (io_read_at(AT_FDCWD, "/proc/self/cgroup", cg, sizeof cg) <= 0 ||
+      io_access(CGROUP_ROOT "/cgroup.controllers") != 0)
+    return -1;
+
+  for (char *line = cg; line; line = strchr(line, '\n')) {
+    if (*line == '\n') line++;
+    if (strncmp(line, "0::", 3) != 0) continue;
+    line += 3;
+    line[strcspn(line, "\n")] = '\0';
+    /* "/" is root of cgroup namespace, which is what is mounted */
+    int n = snprintf(buf, size, CGROUP_ROOT "%s",
+                     strcmp(line, "/") ? line : "");
+    return n < (int)size ? 0 : -1;
+  }
+  return -1;
+}
+
+/* function that parses memory.max, -1 if it is "max" */
+static double
+parse_memory_max(const char *s)
+{
+  return strncmp(s, "max", 3) ? strtod(s, NULL) : -1;
+}
+
+/* function that parses cpu.max "quota period" to CPUs, -1 if unlimited */
+static double
+parse_cpu_max(const char *s)
+{
+  double quota, period;
+  if (sscanf(s, "%lf %lf", &quota, &period) != 2 || period <= 0) return -1;
+  return quota / period;
+}
+
+/*
+ * function that returns the lowest limit in file of cgroup path and of
+ * its parents (limits of parents apply too), -1 if there is none
+ */
+static double
+cgroup_limit(const char *path, const char *file,
+             double (*parse)(const char *))
+{
+  char dir[4096], file_path[4200], buf[64];
+  double min = -1;
+
+  snprintf(dir, sizeof dir, "%s", path);
+  for (;;) {
+    snprintf(file_path, sizeof file_path, "%s/%s", dir, file);
+    if (io_read_at(AT_FDCWD, file_path, buf, sizeof buf) > 0) {
+      double limit = parse(buf);
+      if (limit >= 0 && (min < 0 || limit < min)) min = limit;
+    }
+    if (strlen(dir) <= strlen(CGROUP_ROOT)) break;
+    *strrchr(dir, '/') = '\0';
+  }
+  return min;
+}
+
+/*
+ * function that counts CPUs of list file like "0-3,8-11"
+ * returns -1 on error
+ */
+static int
+count_cpu_list(const char *path)
+{
+  char buf[1024];
+  if (io_read_at(AT_FDCWD, path, buf, sizeof buf) <= 0) return -1;
+
+  int count = 0;
+  for (char *p = buf; *p >= '0' && *p <= '9';) {
+    long first = strtol(p, &p, 10), last = first;
+    if (*p == '-') last = strtol(p + 1, &p, 10);
+    count += (int)(last - first + 1);
+    if (*p == ',') p++;
+  }
+  return count;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+enum { EAX, EBX, ECX, EDX };
+
+/*
+ * function that executes cpuid, r is zeroed if leaf isn't supported,
+ * leaves are captured like files (see io.h)
+ */
+static void
+cpuid(unsigned leaf, unsigned sub, unsigned r[4])
+{
+  char key[32] = "";
+  if (io_mode() != IO_DIRECT) {
+    snprintf(key, sizeof key, "cpuid.%x.%x", leaf, sub);
+    if (io_value(key, r, 4 * sizeof *r) == 0) return;
+  }
+
+  unsigned max = __get_cpuid_max(leaf & 0xf0000000u, NULL);
+  r[EAX] = r[EBX] = r[ECX] = r[EDX] = 0;
+  /* hypervisor leaves are valid only with hypervisor bit */
+  if ((leaf & 0xf0000000u) == 0x40000000u || leaf <= max)
+    __cpuid_count(leaf, sub, r[EAX], r[EBX], r[ECX], r[EDX]);
+  if (key[0]) io_record(key, r, 4 * sizeof *r);
+}
+#endif
+
+/*
+ * function that reads CPU model name without /proc/cpuinfo
+ * returns -1 if it isn't available
+ */
+static int
+cpu_brand(char *buf, size_t size)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned r[12];
+  char brand[49];
+
+  for (int i = 0; i < 3; i++)
+    cpuid(0x80000002u + i, 0, &r[4 * i]);
+  if (!r[0]) return -1;
+  memcpy(brand, r, 48);
+  brand[48] = '\0';
+
+  char *p = brand + strspn(brand, " ");
+  char *cpu_at = strstr(p, " CPU @");
+  if (cpu_at) *cpu_at = '\0';
+  size_t len = strlen(p);
+  while (len > 0 && p[len - 1] == ' ') p[--len] = '\0';
+  snprintf(buf, size, "%s", p);
+  return 0;
+#else
+  (void)buf;
+  (void)size;
+  return -1;
+#endif
+}
+
+/*
+ * function that returns cgroup memory "used / limit", NULL if fetcha
+ * isn't limited by cgroup v2 (host view is used then)
+ */
+static char *
+cgroup_memory(void)
+{
+  char path[4096], file_path[4200], buf[64];
+  if (!container_view || cgroup_path(path, sizeof path) != 0) return NULL;
+
+  double limit = cgroup_limit(path, "memory.max", parse_memory_max);
+  if (limit < 0) return NULL;
+
+  double used = 0;
+  snprintf(file_path, sizeof file_path, "%s/memory.current", path);
+  if (io_read_at(AT_FDCWD, file_path, buf, sizeof buf) > 0)
+    used = strtod(buf, NULL);
+
+  char *res = malloc(64);
+  if (!res) return NULL;
+  snprintf(res, 64, "%.0fMiB / %.0fMiB (cgroup)",
+           used / 1024 / 1024, limit / 1024 / 1024);
+  return res;
+}
+
+/*
+ * function that returns cgroup CPUs "model (cpuset CPUs, quota)", NULL
+ * if fetcha isn't limited by cgroup v2 (host view is used then)
+ */
+static char *
+cgroup_cpus(void)
+{
+  char path[4096], file_path[4200], model[64];
+  if (!container_view || cgroup_path(path, sizeof path) != 0) return NULL;
+
+  double quota = cgroup_limit(path, "cpu.max", parse_cpu_max);
+  snprintf(file_path, sizeof file_path, "%s/cpuset.cpus.effective", path);
+  int cpus = count_cpu_list(file_path);
+  int online = count_cpu_list("/sys/devices/system/cpu/online");
+  if (cpus < 0) cpus = online;
+  if (quota < 0 && (cpus < 0 || cpus >= online)) return NULL;
+
+  if (cpu_brand(model, sizeof model) != 0) strcpy(model, "CPU");
+  char *res = malloc(128);
+  if (!res) return NULL;
+  if (quota >= 0)
+    snprintf(res, 128, "%s (%d, quota %.2f)", model, cpus, quota);
+  else
+    snprintf(res, 128, "%s (%d)", model, cpus);
+  return res;
+}
+
+
+/* record of getdents64(2), there is no glibc header for it */
+struct dirent64_raw {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+/*
+ * function that adds pid of /proc entry name to *pids (if pids isn't NULL)
+ * returns 0, -1 if there is no memory
+ */
+static int
+add_pid(pid_t **pids, long count, const char *name)
+{
+  if (!pids) return 0;
+  /* grows by doubling, count is the length */
+  if ((count & (count - 1)) == 0 && count >= 64) {
+    pid_t *p = realloc(*pids, count * 2 * sizeof *p);
+    if (!p) return -1;
+    *pids = p;
+  }
+  (*pids)[count] = atoi(name);
+  return 0;
+}
+
+/*
+ * function that lists processes (numeric directories of /proc)
+ * with getdents64 and large buffer, no syscall per process,
+ * pids are stored to *pids (freed by caller), if pids isn't NULL
+ * returns count, -1 on error
+ */
+static long
+list_pids(pid_t **pids)
+{
+  size_t size = 1 << 17;
+  char *buf;
+  long count = 0;
+
+  if (pids && !(*pids = malloc(64 * sizeof **pids))) return -1;
+
+  /* getdents64 can't be captured, listing can */
+  if (io_mode() != IO_DIRECT) {
+    io_dir *d = io_opendir("/proc");
+    const char *name = NULL;
+    while (d && (name = io_readdir(d)))
+      if (name[0] >= '1' && name[0] <= '9') {
+        if (add_pid(pids, count, name) != 0) break;
+        count++;
+      }
+    io_closedir(d);
+    if (d && !name) return count;
+    if (pids) free(*pids);
+    return -1;
   }
 
-  long mem_total = 0;
-  char *mem_total_type = "KiB";
-  long mem_free = 0;
-  long buffers = 0;
-  long cached = 0;
+  buf = malloc(size);
+  int fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  long n = -1;
+  while (buf && fd >= 0 && (n = syscall(SYS_getdents64, fd, buf, size)) > 0) {
+    for (long off = 0; off < n; ) {
+      struct dirent64_raw *e = (struct dirent64_raw *)(buf + off);
+      if (e->d_name[0] >= '1' && e->d_name[0] <= '9') {
+        if (add_pid(pids, count, e->d_name) != 0) {
+          n = -1;
+          break;
+        }
+        count++;
+      }
+      off += e->d_reclen;
+    }
+    if (n < 0) break;
+  }
+  if (fd >= 0) close(fd);
+  free(buf);
+  if (n == 0) return count;
+  if (pids) free(*pids);
+  return -1;
+}
+
+/* fields of /proc/meminfo, KiB (huge_* are pages, huge_size KiB) */
+typedef struct {
+  long total, free, buffers, cached, available;
+  long swap_total, swap_free;
+  long huge_total, huge_free, huge_size;
+} meminfo;
 
-  char key[32];
-  long value;
-  char unit[16];
+/*
+ * function that reads /proc/meminfo in one pass, missing fields are 0
+ * returns 0 on success, -1 on error
+ */
+static int
+read_meminfo(meminfo *m)
+{
+  static const struct {
+    const char *key;
+    size_t off;
+  } keys[] = {
+    { "MemTotal:",        offsetof(meminfo, total) },
+    { "MemFree:",         offsetof(meminfo, free) },
+    { "MemAvailable:",    offsetof(meminfo, available) },
+    { "Buffers:",         offsetof(meminfo, buffers) },
+    { "Cached:",          offsetof(meminfo, cached) },
+    { "SwapTotal:",       offsetof(meminfo, swap_total) },
+    { "SwapFree:",        offsetof(meminfo, swap_free) },
+    { "HugePages_Total:", offsetof(meminfo, huge_total) },
+    { "HugePages_Free:",  offsetof(meminfo, huge_free) },
+    { "Hugepagesize:",    offsetof(meminfo, huge_size) },
+  };
+  char line[256];
 
-  while(fscanf(f, "%31s %ld %15s", key, &value, unit) == 3) {
-    if (strcmp(key, "MemTotal:") == 0) {
-      mem_total = value;
-    } else if (strcmp(key, "MemFree:") == 0) {
-      mem_free = value;
-    } else if (strcmp(key, "Buffers:") == 0) {
-      buffers = value;
-    } else if (strcmp(key, "Cached:") == 0) {
-      cached = value;
+  FILE *f = io_fopen("/proc/meminfo");
+  if (!f) return -1;
+  memset(m, 0, sizeof *m);
+  while (fgets(line, sizeof line, f)) {
+    for (size_t i = 0; i < sizeof keys / sizeof keys[0]; i++) {
+      size_t n = strlen(keys[i].key);
+      if (!strncmp(line, keys[i].key, n)) {
+        *(long *)((char *)m + keys[i].off) = strtol(line + n, NULL, 10);
+        break;
+      }
     }
   }
   fclose(f);
+  return 0;
+}
+
+/*
+ * function that writes kib as "NKiB" or "NMiB" to buf
+ * returns buf
+ */
+static char *
+format_kib(char *buf, size_t size, long kib)
+{
+  if (kib >= 1024)
+    snprintf(buf, size, "%ldMiB", kib / 1024);
+  else
+    snprintf(buf, size, "%ldKiB", kib);
+  return buf;
+}
+
+/*
+ * function that sums mm_stat of zram devices: orig - data stored in them,
+ * used - memory they take (KiB)
+ * returns count of devices
+ */
+static int
+zram_usage(long *orig, long *used)
+{
+  io_dir *d = io_opendir("/sys/block");
+  const char *name;
+  char path[300], buf[256];
+  int count = 0;
+
+  *orig = *used = 0;
+  while (d && (name = io_readdir(d))) {
+    long long o, u;
+    if (strncmp(name, "zram", 4)) continue;
+    snprintf(path, sizeof path, "/sys/block/%s/mm_stat", name);
+    if (io_read_at(AT_FDCWD, path, buf, sizeof buf) <= 0 ||
+        sscanf(buf, "%lld %*s %lld", &o, &u) != 2)
+      continue;
+    *orig += o / 1024;
+    *used += u / 1024;
+    count++;
+  }
+  io_closedir(d);
+  return count;
+}
+
+/*
+ * function that appends "\navail N, swap U / T, zram O in U, huge U / T"
+ * (parts the machine has) to buf
+ */
+static void
+memory_detail_row(char *buf, size_t size, const meminfo *m)
+{
+  char a[32], b[32];
+  size_t len = strlen(buf);
+  long orig, used;
+
+  len += snprintf(buf + len, size - len, "\navail %s",
+                  format_kib(a, sizeof a, m->available));
+  if (m->swap_total > 0 && len < size)
+    len += snprintf(buf + len, size - len, ", swap %s / %s",
+                    format_kib(a, sizeof a, m->swap_total - m->swap_free),
+                    format_kib(b, sizeof b, m->swap_total));
+  if (zram_usage(&orig, &used) > 0 && len < size)
+    len += snprintf(buf + len, size - len, ", zram %s in %s",
+                    format_kib(a, sizeof a, orig),
+                    format_kib(b, sizeof b, used));
+  if (m->huge_total > 0 && len < size)
+    snprintf(buf + len, size - len, ", huge %ld / %ld x %s",
+             m->huge_total - m->huge_free, m->huge_total,
+             format_kib(a, sizeof a, m->huge_size));
+}
+
+/* resident set of process, pages */
+typedef struct {
+  long rss;
+  pid_t pid;
+} rss_entry;
+
+/* most processes memory_top shows */
+#define MEMORY_TOP_MAX 32
+
+/* pids one thread of memory_top_threads scans, it keeps own top */
+typedef struct {
+  int proc;                 /* /proc */
+  const pid_t *pids;
+  long count;
+  int cap;
+  int len;
+  rss_entry heap[MEMORY_TOP_MAX]; /* min-heap, smallest of top first */
+  pthread_t thread;
+} rss_shard;
+
+/*
+ * function that adds e to min-heap of at most cap entries,
+ * it replaces the smallest one, if heap is full and e is larger
+ */
+static void
+rss_push(rss_entry *heap, int *len, int cap, rss_entry e)
+{
+  int i;
+
+  if (*len < cap) {
+    /* sift up */
+    for (i = (*len)++; i > 0 && heap[(i - 1) / 2].rss > e.rss; i = (i - 1) / 2)
+      heap[i] = heap[(i - 1) / 2];
+    heap[i] = e;
+    return;
+  }
+  if (e.rss <= heap[0].rss) return;
+
+  /* sift down from the root */
+  for (i = 0; ; ) {
+    int c = 2 * i + 1;
+    if (c >= cap) break;
+    if (c + 1 < cap && heap[c + 1].rss < heap[c].rss) c++;
+    if (heap[c].rss >= e.rss) break;
+    heap[i] = heap[c];
+    i = c;
+  }
+  heap[i] = e;
+}
+
+/*
+ * function that reads /proc/<pid>/statm of pids of shard (thread start)
+ */
+static void *
+rss_scan(void *arg)
+{
+  rss_shard *s = arg;
+  char path[32], buf[128];
+
+  for (long i = 0; i < s->count; i++) {
+    snprintf(path, sizeof path, "%d/statm", (int)s->pids[i]);
+    /* size resident shared ... */
+    char *p = io_read_at(s->proc, path, buf, sizeof buf) > 0 ?
+              strchr(buf, ' ') : NULL;
+    long rss = p ? strtol(p + 1, NULL, 10) : 0;
+    if (rss > 0)
+      rss_push(s->heap, &s->len, s->cap, (rss_entry){ rss, s->pids[i] });
+  }
+  return NULL;
+}
+
+static int
+rss_compare(const void *a, const void *b)
+{
+  long x = ((const rss_entry *)a)->rss, y = ((const rss_entry *)b)->rss;
+  return (x < y) - (x > y);
+}
+
+/*
+ * function that appends rows "comm (pid) rss" of memory_top processes
+ * with the largest resident set to buf, statm of pids is read by
+ * memory_top_threads threads, each keeps a min-heap of its top,
+ * comm is read only for the processes shown
+ */
+static void
+memory_top_rows(char *buf, size_t size)
+{
+  rss_shard shards[16];
+  rss_entry top[MEMORY_TOP_MAX];
+  pid_t *pids;
+  int cap = memory_top < MEMORY_TOP_MAX ? memory_top : MEMORY_TOP_MAX;
+  int threads = memory_top_threads, len = 0;
+  size_t used = strlen(buf);
+
+  long count = list_pids(&pids);
+  int proc = io_open_dir(AT_FDCWD, "/proc");
+  if (count <= 0 || proc < 0) {
+    if (count >= 0) free(pids);
+    if (proc >= 0) io_close_dir(proc);
+    return;
+  }
 
-  long mem_used = mem_total - mem_free - buffers - cached;\
-  char *mem_used_type = "KiB";
+  /* a thread is worth it for thousands of processes */
+  if (threads > (int)(sizeof shards / sizeof shards[0]))
+    threads = sizeof shards / sizeof shards[0];
+  if (threads > count / 2048 + 1) threads = count / 2048 + 1;
+  if (threads < 1) threads = 1;
 
-  if (mem_total >= 1024) {
-    mem_total /= 1024;
-    mem_total_type = "MiB";
+  for (int t = 0; t < threads; t++) {
+    long from = count * t / threads, to = count * (t + 1) / threads;
+    shards[t] = (rss_shard){ proc, pids + from, to - from, cap, 0, {{0}}, 0 };
   }
-  if (mem_used >= 1024) {
-    mem_used /= 1024;
-    mem_used_type = "MiB";
+  for (int t = 1; t < threads; t++)
+    if (pthread_create(&shards[t].thread, NULL, rss_scan, &shards[t]) != 0)
+      shards[t].thread = pthread_self();
+  rss_scan(&shards[0]);
+  for (int t = 1; t < threads; t++) {
+    if (pthread_equal(shards[t].thread, pthread_self()))
+      rss_scan(&shards[t]);
+    else
+      pthread_join(shards[t].thread, NULL);
+    for (int i = 0; i < shards[t].len; i++)
+      rss_push(shards[0].heap, &shards[0].len, cap, shards[t].heap[i]);
+  }
+  len = shards[0].len;
+  memcpy(top, shards[0].heap, len * sizeof *top);
+  qsort(top, len, sizeof *top, rss_compare);
+
+  long page_kib = sysconf(_SC_PAGESIZE) / 1024;
+  for (int i = 0; i < len && used < size; i++) {
+    char path[32], comm[32], rss[32];
+    snprintf(path, sizeof path, "%d/comm", (int)top[i].pid);
+    if (io_read_at(proc, path, comm, sizeof comm) <= 0) strcpy(comm, "?");
+    comm[strcspn(comm, "\n")] = '\0';
+    used += snprintf(buf + used, size - used, "\n%s (%d) %s", comm,
+                     (int)top[i].pid,
+                     format_kib(rss, sizeof rss, top[i].rss * page_kib));
+  }
+  io_close_dir(proc);
+  free(pids);
+}
+
+/*
+ * function that returns "used / total" (of cgroup, if container_view),
+ * memory_detail adds row of available, swap, zram and huge pages,
+ * memory_top rows of processes with the largest resident set
+ */
+char *
+get_memory(void) {
+  char *cgroup = cgroup_memory();
+  if (cgroup && !memory_detail && memory_top <= 0) return cgroup;
+
+  size_t size = 256 + 64 * MEMORY_TOP_MAX;
+  char *buf = malloc(size), a[32], b[32];
+  meminfo m;
+  int err = read_meminfo(&m);
+  if (!buf || (err && !cgroup)) {
+    free(buf);
+    return cgroup ? cgroup : strdup("unknown");
   }
 
-  snprintf(buf, 64, "%ld%s / %ld%s", 
-      mem_used, mem_used_type, mem_total, mem_total_type);
+  if (cgroup) {
+    snprintf(buf, size, "%s", cgroup);
+    free(cgroup);
+  } else {
+    long used = m.total - m.free - m.buffers - m.cached;
+    snprintf(buf, size, "%s / %s", format_kib(a, sizeof a, used),
+             format_kib(b, sizeof b, m.total));
+  }
+  if (memory_detail && !err) memory_detail_row(buf, size, &m);
+  if (memory_top > 0) memory_top_rows(buf, size);
   return buf;
 }
 
@@ -264,7 +974,10 @@ get_memory(void) {
 
 char *
 get_cpus(void) {
-  FILE *f = fopen("/proc/cpuinfo", "r");
+  char *cgroup = cgroup_cpus();
+  if (cgroup) return cgroup;
+
+  FILE *f = io_fopen("/proc/cpuinfo");
   if (!f) {
     return strdup("unknown");
   }
@@ -328,7 +1041,7 @@ get_cpus(void) {
         "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", 
         cpus[i].first_logical);
     unsigned long max_khz = 0;
-    FILE *freq_file = fopen(path, "r");
+    FILE *freq_file = io_fopen(path);
     if (freq_file) {
       fscanf(freq_file, "%lu", &max_khz);
       fclose(freq_file);
@@ -350,7 +1063,7 @@ get_cpus(void) {
 char *
 get_gpus(void)
 {
-  FILE *f = popen("lspci | grep -i VGA", "r");
+  FILE *f = io_popen("lspci | grep -i VGA");
   typedef struct {
     char brand[64];
     char model[128];
@@ -403,7 +1116,7 @@ get_gpus(void)
     gpu_num++;
   }
 
-  pclose(f);
+  io_pclose(f);
   return buffer;
 }
 
@@ -413,6 +1126,13 @@ get_gpus(void)
 char *
 get_wm(void)
 {
+  char captured[256] = "";
+
+  /* X11 can't be captured, its result is */
+  if (io_value("wm", captured, sizeof captured - 1) == 0)
+    return strdup(captured);
+  if (io_mode() == IO_REPLAY) return strdup("unknown");
+
   Display *dpy = XOpenDisplay(NULL);
   if (!dpy) {
     return strdup("unknown");
@@ -450,70 +1170,381 @@ get_wm(void)
   char *name = strndup((char *)prop, nitems);
   XFree(prop);
 
+  if (name) io_record("wm", name, strlen(name) + 1);
   return name;
 }
 
+/*
+ * process names for ancestry walk, it stops at stopped ones:
+ * multiplexer server's terminal is the one of its client,
+ * systemd --user and init adopt orphans
+ */
+static const char *shells[] = {
+  "sh", "bash", "zsh", "fish", "dash", "ksh", "mksh", "oksh", "tcsh", "csh",
+  "nu", "elvish", "xonsh", "yash", "ion", NULL
+};
+
+static const char *stopped[] = {
+  "tmux: server", "tmux", "screen", "SCREEN", "zellij", "abduco", "dtach",
+  "systemd", "init", NULL
+};
+
+static const char *terminal_names[][2] = {
+  { "gnome-terminal-", "GNOME Terminal" },
+  { "kgx",             "GNOME Console" },
+  { "konsole",         "Konsole" },
+  { "xfce4-terminal",  "Xfce Terminal" },
+  { "mate-terminal",   "MATE Terminal" },
+  { "lxterminal",      "LXTerminal" },
+  { "qterminal",       "QTerminal" },
+  { "alacritty",       "Alacritty" },
+  { "kitty",           "kitty" },
+  { "wezterm-gui",     "WezTerm" },
+  { "ghostty",         "Ghostty" },
+  { "foot",            "foot" },
+  { "footclient",      "foot" },
+  { "urxvt",           "rxvt-unicode" },
+  { "urxvtd",          "rxvt-unicode" },
+  { "xterm",           "XTerm" },
+  { "tilix",           "Tilix" },
+  { "terminator",      "Terminator" },
+  { "terminology",     "Terminology" },
+  { "sakura",          "Sakura" },
+  { "st",              "st" },
+  { "code",            "VS Code" },
+  { "login",           "Linux console" },
+};
+
+static pthread_mutex_t ancestry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ancestry anc;
+static pid_t anc_from;   /* 0 - parent of fetcha */
+static bool  anc_done;
+
+static bool
+in_list(const char *name, const char **list)
+{
+  for (; *list; list++)
+    if (!strcmp(name, *list)) return true;
+  return false;
+}
+
+/*
+ * function that returns pretty name of terminal emulator comm,
+ * NULL if comm isn't known terminal
+ */
+static const char *
+terminal_name(const char *comm)
+{
+  for (size_t i = 0; i < sizeof terminal_names / sizeof terminal_names[0];
+       i++)
+    if (!strcmp(comm, terminal_names[i][0]))
+      return terminal_names[i][1];
+  return NULL;
+}
+
+/*
+ * function that reads name and parent of pid from <pid>/stat
+ * relative to proc (open /proc)
+ * returns 0 on success, -1 on error
+ */
+static int
+read_proc(int proc, pid_t pid, struct proc *p, pid_t *ppid)
+{
+  char path[32], buf[512];
+  snprintf(path, sizeof path, "%d/stat", (int)pid);
+  if (io_read_at(proc, path, buf, sizeof buf) <= 0)
+    return -1;
+
+  /* "pid (comm) state ppid", comm may contain spaces and ")" */
+  char *open = strchr(buf, '('), *close = strrchr(buf, ')');
+  if (!open || !close || close < open ||
+      sscanf(close + 1, " %*c %d", ppid) != 1)
+    return -1;
+  size_t len = close - open - 1;
+  if (len >= sizeof p->comm) len = sizeof p->comm - 1;
+  memcpy(p->comm, open + 1, len);
+  p->comm[len] = '\0';
+  p->pid = pid;
+  return 0;
+}
+
+/*
+ * function that walks parents of fetcha (at most ANCESTRY_MAX) once,
+ * with one read of <pid>/stat per process, and finds the nearest shell
+ * and the terminal emulator (first known one of terminal_names), other
+ * processes (make, sudo, editors) are walked through, walk stops
+ * at multiplexer server, systemd and sshd, terminal stays -1 then
+ */
+const struct ancestry *
+ancestry(void)
+{
+  pthread_mutex_lock(&ancestry_lock);
+  if (anc_done) {
+    pthread_mutex_unlock(&ancestry_lock);
+    return &anc;
+  }
+  anc_done = true;
+  anc.count = 0;
+  anc.shell = anc.terminal = -1;
+  anc.shell_exe[0] = '\0';
+
+  int proc = io_open_dir(AT_FDCWD, "/proc");
+  pid_t pid = anc_from > 0 ? anc_from : io_getppid();
+  while (proc >= 0 && pid > 1 && anc.count < ANCESTRY_MAX) {
+    struct proc *p = &anc.procs[anc.count];
+    pid_t ppid;
+    if (read_proc(proc, pid, p, &ppid) != 0) break;
+    anc.count++;
+
+    if (in_list(p->comm, shells)) {
+      if (anc.shell < 0) anc.shell = anc.count - 1;
+    } else if (terminal_name(p->comm)) {
+      anc.terminal = anc.count - 1;
+      break;
+    } else if (in_list(p->comm, stopped) || !strcmp(p->comm, "sshd") ||
+               !strncmp(p->comm, "sshd-", 5)) {
+      break; /* terminal is on the other side */
+    }
+    pid = ppid;
+  }
+
+  if (anc.shell >= 0) {
+    char path[32];
+    snprintf(path, sizeof path, "%d/exe", (int)anc.procs[anc.shell].pid);
+    ssize_t n = io_readlink_at(proc, path, anc.shell_exe,
+                           sizeof anc.shell_exe - 1);
+    anc.shell_exe[n > 0 ? n : 0] = '\0';
+    /* binary was replaced by package upgrade */
+    size_t len = strlen(anc.shell_exe), del = strlen(" (deleted)");
+    if (len > del && !strcmp(anc.shell_exe + len - del, " (deleted)"))
+      anc.shell_exe[len - del] = '\0';
+  }
+  if (proc >= 0) io_close_dir(proc);
+  pthread_mutex_unlock(&ancestry_lock);
+  return &anc;
+}
+
+/*
+ * function that makes next ancestry() walk from pid
+ * (parent of fetcha client in daemon), 0 - parent of fetcha
+ */
+void
+ancestry_from(pid_t pid)
+{
+  pthread_mutex_lock(&ancestry_lock);
+  anc_from = pid;
+  anc_done = false;
+  pthread_mutex_unlock(&ancestry_lock);
+}
+
+/*
+ * function that returns "name version" of shell fetcha runs in
+ * (from ancestry, $SHELL if there is no shell among parents),
+ * last result is kept, so daemon doesn't run shell for every frame
+ */
 char *
 get_shell(void)
 {
-  char *shell = getenv("SHELL");
-  if (!shell) {
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  static char last_shell[256], last[256];
+  const struct ancestry *a = ancestry();
+  char shell[256];
+
+  if (a->shell_exe[0]) {
+    snprintf(shell, sizeof shell, "%s", a->shell_exe);
+  } else if (getenv("SHELL")) {
+    snprintf(shell, sizeof shell, "%s", getenv("SHELL"));
+  } else {
     return strdup("unknown");
   }
 
-  char cmd[256];
-  snprintf(cmd, sizeof(cmd), "%s --version 2>/dev/null", shell);
+  pthread_mutex_lock(&lock);
+  if (!strcmp(shell, last_shell)) {
+    pthread_mutex_unlock(&lock);
+    return strdup(last);
+  }
+  pthread_mutex_unlock(&lock);
+
+  /* path in single quotes, ' as '\'' */
+  char cmd[1100];
+  size_t len = 0;
+  cmd[len++] = '\'';
+  for (const char *p = shell; *p; p++) {
+    if (*p == '\'') {
+      memcpy(cmd + len, "'\\''", 4);
+      len += 4;
+    } else {
+      cmd[len++] = *p;
+    }
+  }
+  snprintf(cmd + len, sizeof cmd - len, "' --version 2>/dev/null");
 
-  FILE *f =  popen(cmd, "r");
+  FILE *f = io_popen(cmd);
   if (!f) {
     return strdup(shell);
   }
 
   char buf[256];
   if (!fgets(buf, sizeof(buf), f)) {
-    pclose(f);
+    io_pclose(f);
     return strdup(shell);
   }
-  pclose(f);
+  io_pclose(f);
 
   buf[strcspn(buf, "\n")] = 0; /* without \n */
 
   /* parse: name version */
-  char *name = strtok(buf, " ,");
-  char *ver  = strtok(NULL, " ,");
+  char *save;
+  char *name = strtok_r(buf, " ,", &save);
+  char *ver  = strtok_r(NULL, " ,", &save);
 
-  char out[128];
+  char out[256];
   if (name && ver) {
     snprintf(out, sizeof(out), "%s %s", name, ver);
   } else {
     snprintf(out, sizeof(out), "%s", shell);
   }
 
+  pthread_mutex_lock(&lock);
+  snprintf(last_shell, sizeof last_shell, "%s", shell);
+  snprintf(last, sizeof last, "%s", out);
+  pthread_mutex_unlock(&lock);
   return strdup(out);
-
 }
 
-pid_t
-get_parent_pid(pid_t pid)
+/*
+ * function that asks terminal on fd for its name and version (XTVERSION),
+ * followed by DA1, that every terminal answers, so the reply ends
+ * with DA1, input is read until then or terminal_query_ms,
+ * only ICANON and ECHO are cleared, OPOST stays for frame being printed
+ * returns 0 and name ("" if terminal doesn't know XTVERSION),
+ * -1 if terminal didn't answer (name is "")
+ */
+static int
+term_query(int fd, char *name, size_t size)
 {
-  char path[64];
-  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
-
-  FILE *f = fopen(path, "r");
-  if (!f) {
-    return 0;
+  struct termios old, raw;
+  char buf[512];
+  size_t len = 0;
+  int ret = -1;
+
+  name[0] = '\0';
+  if (tcgetattr(fd, &old) != 0) return -1;
+
+  /* don't steal what user typed ahead */
+  struct pollfd p = { fd, POLLIN, 0 };
+  if (poll(&p, 1, 0) != 0) return -1;
+
+  raw = old;
+  raw.c_lflag &= ~(ICANON | ECHO);
+  raw.c_cc[VMIN] = 0;
+  raw.c_cc[VTIME] = 0;
+  if (tcsetattr(fd, TCSANOW, &raw) != 0) return -1;
+
+  static const char query[] = "\x1b[>q\x1b[c";
+  struct timespec now, end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  long long end_ms = end.tv_sec * 1000LL + end.tv_nsec / 1000000 +
+                     terminal_query_ms;
+
+  if (write(fd, query, sizeof query - 1) == sizeof query - 1) {
+    while (len < sizeof buf - 1) {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      long long left = end_ms - (now.tv_sec * 1000LL + now.tv_nsec / 1000000);
+      if (left <= 0 || poll(&p, 1, (int)left) <= 0) break;
+      ssize_t n = read(fd, buf + len, sizeof buf - 1 - len);
+      if (n <= 0) break;
+      len += n;
+      buf[len] = '\0';
+
+      /* DA1: CSI ? ... c */
+      char *da = strstr(buf, "\x1b[?");
+      if (da && strchr(da, 'c')) {
+        ret = 0;
+        break;
+      }
+    }
   }
 
-  pid_t ppid = 0;
-  fscanf(f, "%*d %*s %*c %d", &ppid);
-  fclose(f);
-  return ppid;
+  /* late or partial reply mustn't reach the shell */
+  if (ret != 0) tcflush(fd, TCIFLUSH);
+  tcsetattr(fd, TCSANOW, &old);
+  if (ret != 0) return -1;
+
+  /* XTVERSION: DCS > | text ST */
+  char *v = strstr(buf, "\x1bP>|");
+  if (v) {
+    v += 4;
+    size_t n = strcspn(v, "\x1b");
+    if (n >= size) n = size - 1;
+    memcpy(name, v, n);
+    name[n] = '\0';
+  }
+  return 0;
+}
 
+/*
+ * function that returns name of terminal from XTVERSION,
+ * cached for $TERM, tty and session in state directory
+ * (empty file, if terminal doesn't answer),
+ * returns NULL if name isn't known
+ */
+static char *
+term_version(void)
+{
+  char path[4096], key[128], name[256] = "";
+  struct stat st;
+  const char *term = getenv("TERM");
+
+  int fd = open("/dev/tty", O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (fd < 0) return NULL;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return NULL;
+  }
+  snprintf(key, sizeof key, "term.%08x.%lx.%d",
+           hash_str(term ? term : "", 0), (unsigned long)st.st_rdev,
+           (int)getsid(0));
+
+  bool cache = state_path(key, path, sizeof path) == 0;
+  if (cache && io_read_at(AT_FDCWD, path, name, sizeof name) >= 0) {
+    close(fd);
+    return name[0] ? strdup(name) : NULL;
+  }
+
+  term_query(fd, name, sizeof name);
+  close(fd);
+
+  char tmp[sizeof path + 8];
+  snprintf(tmp, sizeof tmp, "%s.XXXXXX", path);
+  int out = cache ? mkstemp(tmp) : -1;
+  if (out >= 0) {
+    size_t n = strlen(name);
+    if (write(out, name, n) != (ssize_t)n || close(out) != 0 ||
+        rename(tmp, path) != 0)
+      unlink(tmp);
+  }
+  return name[0] ? strdup(name) : NULL;
 }
 
+/*
+ * function that returns pretty name of terminal emulator from ancestry,
+ * or from the terminal itself
+ * (if terminal_query), or $TERMINAL, $TERM_PROGRAM, $TERM
+ */
 char *
 get_terminal(void)
 {
+    const struct ancestry *a = ancestry();
+    if (a->terminal >= 0)
+      return strdup(terminal_name(a->procs[a->terminal].comm));
+
+    /* daemon renders for client, its tty isn't the client's one */
+    char *name;
+    if (terminal_query && !anc_from && io_mode() == IO_DIRECT &&
+        (name = term_version()))
+      return name;
+
     char *term = getenv("TERMINAL");
     if (term && *term) { 
       return strdup(term);
@@ -542,3 +1573,1123 @@ get_editor(void)
 
   return strdup("unknown");
 }
+
+
+/*
+ * function that writes path of fetcha state file "name" to buf,
+ * state lives in $XDG_RUNTIME_DIR/fetcha (or /tmp/fetcha-uid),
+ * directory is created if needed
+ * returns 0 on success, -1 on error
+ */
+int
+state_path(const char *name, char *buf, size_t size)
+{
+  const char *run = getenv("XDG_RUNTIME_DIR");
+  if (run && *run)
+    snprintf(buf, size, "%s/fetcha", run);
+  else
+    snprintf(buf, size, "/tmp/fetcha-%d", (int)getuid());
+
+  if (mkdir(buf, 0700) != 0 && errno != EEXIST)
+    return -1;
+
+  size_t len = strlen(buf);
+  if ((size_t)snprintf(buf + len, size - len, "/%s", name) >= size - len)
+    return -1;
+  return 0;
+}
+
+
+#define CPU_LOAD_MAX 1025 /* aggregate + per core */
+#define NODES_MAX    64
+
+typedef struct {
+  long long time_ns;   /* CLOCK_MONOTONIC of sample */
+  int count;           /* 1 - aggregate only, 1 + n - with per core */
+  int id[CPU_LOAD_MAX];  /* cpu number, -1 for aggregate */
+  unsigned long long total[CPU_LOAD_MAX];
+  unsigned long long idle[CPU_LOAD_MAX];
+} cpu_sample;
+
+static long long
+monotonic_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * function that reads "cpu" lines of /proc/stat,
+ * only the first one if per core isn't needed
+ * returns 0 on success, -1 on error
+ */
+static int
+read_cpu_sample(cpu_sample *s, int want_cores)
+{
+  FILE *f = io_fopen("/proc/stat");
+  if (!f) return -1;
+
+  char line[512];
+  s->count = 0;
+  /* clock can't be captured, its reading is */
+  if (io_value("cpu_load.time", &s->time_ns, sizeof s->time_ns) != 0) {
+    s->time_ns = monotonic_ns();
+    io_record("cpu_load.time", &s->time_ns, sizeof s->time_ns);
+  }
+  while (s->count < CPU_LOAD_MAX && fgets(line, sizeof line, f)) {
+    unsigned long long v[8] = {0};
+    char *p;
+    if (strncmp(line, "cpu", 3) != 0) break;
+    s->id[s->count] = (line[3] == ' ') ? -1 : (int)strtol(line + 3, &p, 10);
+    p = strchr(line, ' ');
+    if (!p) break;
+    sscanf(p, "%llu %llu %llu %llu %llu %llu %llu %llu",
+           &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+    s->total[s->count] = v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+    s->idle[s->count] = v[3] + v[4]; /* idle + iowait */
+    s->count++;
+    if (!want_cores) break;
+  }
+  fclose(f);
+  return s->count > 0 ? 0 : -1;
+}
+
+static int
+load_cpu_sample(FILE *f, cpu_sample *s)
+{
+  int ok = fscanf(f, "%lld %d", &s->time_ns, &s->count) == 2 &&
+           s->count > 0 && s->count <= CPU_LOAD_MAX;
+  for (int i = 0; ok && i < s->count; i++)
+    ok = fscanf(f, "%d %llu %llu", &s->id[i], &s->total[i], &s->idle[i]) == 3;
+  return ok ? 0 : -1;
+}
+
+/*
+ * function that loads at most 2 samples from state file path to saved,
+ * content of the file is captured as value, path differs between hosts
+ * (path is NULL if there is no state directory)
+ * returns count of samples
+ */
+static int
+load_cpu_samples(const char *path, cpu_sample *saved)
+{
+  size_t size = 2 * (32 + CPU_LOAD_MAX * 64), len = 0;
+  char *state = calloc(1, size);
+  int have = 0;
+
+  if (!state) return 0;
+  if (io_value("cpu_load.state", state, size - 1) != 0 &&
+      io_mode() != IO_REPLAY && path) {
+    FILE *f = fopen(path, "r");
+    if (f) {
+      len = fread(state, 1, size - 1, f);
+      fclose(f);
+    }
+    state[len] = '\0';
+    io_record("cpu_load.state", state, len + 1);
+  }
+
+  FILE *f = (len = strlen(state)) ? fmemopen(state, len, "r") : NULL;
+  if (f) {
+    while (have < 2 && load_cpu_sample(f, &saved[have]) == 0) have++;
+    fclose(f);
+  }
+  free(state);
+  return have;
+}
+
+static void
+save_cpu_samples(const char *path, const cpu_sample *samples[], int n)
+{
+  char tmp[4096 + 8];
+  snprintf(tmp, sizeof tmp, "%s.XXXXXX", path);
+  int fd = mkstemp(tmp);
+  if (fd < 0) return;
+  FILE *f = fdopen(fd, "w");
+  if (!f) {
+    close(fd);
+    unlink(tmp);
+    return;
+  }
+  for (int k = 0; k < n; k++) {
+    const cpu_sample *s = samples[k];
+    fprintf(f, "%lld %d\n", s->time_ns, s->count);
+    for (int i = 0; i < s->count; i++)
+      fprintf(f, "%d %llu %llu\n", s->id[i], s->total[i], s->idle[i]);
+  }
+  if (fclose(f) != 0 || rename(tmp, path) != 0)
+    unlink(tmp);
+}
+
+/*
+ * function that returns true if samples can be compared:
+ * same cpu lines, and counters only grew (no reboot between)
+ */
+static int
+cpu_samples_match(const cpu_sample *a, const cpu_sample *b)
+{
+  if (a->count != b->count) return 0;
+  for (int i = 0; i < a->count; i++)
+    if (a->id[i] != b->id[i] || b->total[i] < a->total[i] ||
+        b->idle[i] < a->idle[i])
+      return 0;
+  return b->total[0] > a->total[0];
+}
+
+static double
+cpu_util(unsigned long long total, unsigned long long idle)
+{
+  return total ? (total - idle) * 100.0 / total : 0;
+}
+
+/*
+ * function that reads "some avg10" from /proc/pressure/name,
+ * returns -1 if PSI isn't supported
+ */
+static double
+read_psi(const char *name)
+{
+  char path[64];
+  double avg10 = -1;
+  snprintf(path, sizeof path, "/proc/pressure/%s", name);
+  FILE *f = io_fopen(path);
+  if (!f) return -1;
+  if (fscanf(f, "some avg10=%lf", &avg10) != 1) avg10 = -1;
+  fclose(f);
+  return avg10;
+}
+
+/*
+ * function that fills node_of[cpu] from
+ * /sys/devices/system/node/nodeN/cpulist ("0-3,8-11")
+ * returns count of nodes
+ */
+static int
+read_numa_map(int *node_of, int max)
+{
+  char path[64], list[4096];
+  int n;
+  for (int i = 0; i < max; i++) node_of[i] = -1;
+  for (n = 0; n < NODES_MAX; n++) {
+    snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", n);
+    FILE *f = io_fopen(path);
+    if (!f) break;
+    if (fgets(list, sizeof list, f)) {
+      char *save;
+      for (char *p = strtok_r(list, ",\n", &save); p;
+           p = strtok_r(NULL, ",\n", &save)) {
+        int lo, hi;
+        int k = sscanf(p, "%d-%d", &lo, &hi);
+        if (k == 1) hi = lo;
+        for (int c = lo; k >= 1 && c <= hi && c < max; c++)
+          if (c >= 0) node_of[c] = n;
+      }
+    }
+    fclose(f);
+  }
+  return n;
+}
+
+/*
+ * function that returns malloc string with cpu utilization since
+ * previous run of fetcha (sample is kept in state file "cpu_load"),
+ * sleeps cpu_load_sample_ms only if there is no usable previous sample,
+ * optionally with PSI avg10 and per NUMA node/per core rows
+ */
+char *
+get_cpu_load(void)
+{
+  static cpu_sample saved[2], cur;
+  cpu_sample *prev = NULL;
+  char path[4096];
+  int want_cores = cpu_load_percore || cpu_load_numa;
+  int have_state = state_path("cpu_load", path, sizeof path) == 0;
+
+  /* state keeps two samples, so quick reruns use the older one */
+  int have = load_cpu_samples(have_state ? path : NULL, saved);
+
+  if (read_cpu_sample(&cur, want_cores) != 0)
+    return strdup("unknown");
+
+  /* the newest usable sample, that is old enough, else the newest one */
+  long long min_ns = cpu_load_sample_ms * 1000000LL;
+  for (int i = have - 1; i >= 0; i--) {
+    long long age = cur.time_ns - saved[i].time_ns;
+    if (age < 0 || age > cpu_load_max_age * 1000000000LL ||
+        !cpu_samples_match(&saved[i], &cur))
+      continue;
+    if (!prev || age >= min_ns) prev = &saved[i];
+    if (age >= min_ns) break;
+  }
+  if (!prev) {
+    /* no usable sample, take one now */
+    saved[0] = cur;
+    prev = &saved[0];
+  }
+
+  long long age = cur.time_ns - prev->time_ns;
+  if (age < min_ns) {
+    long long wait = min_ns - age;
+    struct timespec ts = { wait / 1000000000LL, wait % 1000000000LL };
+    nanosleep(&ts, NULL);
+    if (read_cpu_sample(&cur, want_cores) != 0 ||
+        !cpu_samples_match(prev, &cur))
+      return strdup("unknown");
+  }
+  /* replay doesn't touch state of this host */
+  if (have_state && io_mode() != IO_REPLAY) {
+    const cpu_sample *keep[2] = { prev, &cur };
+    save_cpu_samples(path, keep, 2);
+  }
+
+  size_t size = 64 + (size_t)cur.count * 24 + NODES_MAX * 24;
+  char *buf = malloc(size);
+  if (!buf) return NULL;
+  snprintf(buf, size, "%.0f%%",
+           cpu_util(cur.total[0] - prev->total[0], cur.idle[0] - prev->idle[0]));
+
+  if (cpu_load_psi) {
+    double c = read_psi("cpu"), m = read_psi("memory"), io = read_psi("io");
+    size_t len = strlen(buf);
+    if (c >= 0 && m >= 0 && io >= 0)
+      snprintf(buf + len, size - len, " (PSI cpu %.2f mem %.2f io %.2f)",
+               c, m, io);
+  }
+
+  if (cpu_load_numa) {
+    static int node_of[CPU_LOAD_MAX];
+    unsigned long long total[NODES_MAX] = {0}, idle[NODES_MAX] = {0};
+    int nodes = read_numa_map(node_of, CPU_LOAD_MAX);
+    for (int i = 1; i < cur.count; i++) {
+      int n = cur.id[i] >= 0 && cur.id[i] < CPU_LOAD_MAX ? node_of[cur.id[i]] : -1;
+      if (n < 0) continue;
+      total[n] += cur.total[i] - prev->total[i];
+      idle[n] += cur.idle[i] - prev->idle[i];
+    }
+    for (int n = 0; nodes > 1 && n < nodes; n++) {
+      size_t len = strlen(buf);
+      snprintf(buf + len, size - len, "\nnode%d %.0f%%", n,
+               cpu_util(total[n], idle[n]));
+    }
+  }
+
+  if (cpu_load_percore) {
+    for (int i = 1; i < cur.count; i++) {
+      size_t len = strlen(buf);
+      snprintf(buf + len, size - len, "\ncpu%d %.0f%%", cur.id[i],
+               cpu_util(cur.total[i] - prev->total[i],
+                        cur.idle[i] - prev->idle[i]));
+    }
+  }
+
+  return buf;
+}
+
+
+/*
+ * DRM KMS structures and ioctls (linux uapi drm_mode.h),
+ * copied, so libdrm headers aren't needed
+ */
+struct drm_modeinfo {
+  uint32_t clock;
+  uint16_t hdisplay, hsync_start, hsync_end, htotal, hskew;
+  uint16_t vdisplay, vsync_start, vsync_end, vtotal, vscan;
+  uint32_t vrefresh;
+  uint32_t flags;
+  uint32_t type;
+  char name[32];
+};
+
+struct drm_get_connector {
+  uint64_t encoders_ptr, modes_ptr, props_ptr, prop_values_ptr;
+  uint32_t count_modes, count_props, count_encoders;
+  uint32_t encoder_id, connector_id, connector_type, connector_type_id;
+  uint32_t connection, mm_width, mm_height, subpixel, pad;
+};
+
+struct drm_get_encoder {
+  uint32_t encoder_id, encoder_type, crtc_id, possible_crtcs, possible_clones;
+};
+
+struct drm_crtc {
+  uint64_t set_connectors_ptr;
+  uint32_t count_connectors, crtc_id, fb_id, x, y, gamma_size, mode_valid;
+  struct drm_modeinfo mode;
+};
+
+#define DRM_GETCRTC      _IOWR('d', 0xA1, struct drm_crtc)
+#define DRM_GETENCODER   _IOWR('d', 0xA6, struct drm_get_encoder)
+#define DRM_GETCONNECTOR _IOWR('d', 0xA7, struct drm_get_connector)
+
+/*
+ * function that reads active mode of connector from DRM device,
+ * count_modes = 1 keeps kernel from probing outputs (reading EDID)
+ * returns 0 on success, -1 on error
+ */
+static int
+drm_active_mode(int card, uint32_t connector_id, struct drm_modeinfo *mode)
+{
+  struct drm_modeinfo dummy;
+  struct drm_get_connector conn = {0};
+  struct drm_get_encoder enc = {0};
+  struct drm_crtc crtc = {0};
+
+  conn.connector_id = connector_id;
+  conn.count_modes = 1;
+  conn.modes_ptr = (uintptr_t)&dummy;
+  if (ioctl(card, DRM_GETCONNECTOR, &conn) != 0 || !conn.encoder_id)
+    return -1;
+
+  enc.encoder_id = conn.encoder_id;
+  if (ioctl(card, DRM_GETENCODER, &enc) != 0 || !enc.crtc_id)
+    return -1;
+
+  crtc.crtc_id = enc.crtc_id;
+  if (ioctl(card, DRM_GETCRTC, &crtc) != 0 || !crtc.mode_valid)
+    return -1;
+
+  *mode = crtc.mode;
+  return 0;
+}
+
+/*
+ * function that returns row per connected output:
+ * "name WxH @ R Hz", active mode from DRM ioctls (if display_ioctl),
+ * or preferred mode from sysfs
+ */
+char *
+get_display(void)
+{
+  char buf[4096] = "";
+  size_t len = 0;
+  int cards[16];
+
+  io_dir *d = io_opendir("/sys/class/drm");
+  const char *entry;
+  if (!d) return strdup("unknown");
+  for (size_t i = 0; i < sizeof cards / sizeof cards[0]; i++)
+    cards[i] = -2; /* not opened yet */
+
+  while ((entry = io_readdir(d)) && len < sizeof buf - 1) {
+    /* connectors are card<N>-<name> */
+    int card;
+    const char *name = strchr(entry, '-');
+    if (!name || sscanf(entry, "card%d-", &card) != 1)
+      continue;
+    name++;
+
+    char path[512], val[256];
+    snprintf(path, sizeof path, "/sys/class/drm/%s", entry);
+    int dir = io_open_dir(AT_FDCWD, path);
+    if (dir < 0) continue;
+    if (io_read_at(dir, "status", val, sizeof val) < 0 ||
+        strncmp(val, "connected", 9) != 0 ||
+        (io_read_at(dir, "enabled", val, sizeof val) >= 0 &&
+         strncmp(val, "enabled", 7) != 0)) {
+      io_close_dir(dir);
+      continue;
+    }
+
+    struct drm_modeinfo mode;
+    bool active = false;
+    if (display_ioctl && io_mode() == IO_DIRECT && card >= 0 &&
+        (size_t)card < sizeof cards / sizeof cards[0] &&
+        io_read_at(dir, "connector_id", val, sizeof val) > 0) {
+      if (cards[card] == -2) {
+        snprintf(path, sizeof path, "/dev/dri/card%d", card);
+        cards[card] = open(path, O_RDWR | O_CLOEXEC);
+      }
+      active = cards[card] >= 0 &&
+               drm_active_mode(cards[card], strtoul(val, NULL, 10), &mode) == 0;
+    }
+
+    if (active && mode.htotal && mode.vtotal) {
+      double hz = mode.clock * 1000.0 / mode.htotal / mode.vtotal;
+      len += snprintf(buf + len, sizeof buf - len, "%s%s %ux%u @ %.0f Hz",
+                      len ? "\n" : "", name, mode.hdisplay, mode.vdisplay, hz);
+    } else if (io_read_at(dir, "modes", val, sizeof val) > 0) {
+      /* first one is preferred */
+      val[strcspn(val, "\n")] = '\0';
+      len += snprintf(buf + len, sizeof buf - len, "%s%s %s",
+                      len ? "\n" : "", name, val);
+    }
+    io_close_dir(dir);
+  }
+  io_closedir(d);
+
+  for (size_t i = 0; i < sizeof cards / sizeof cards[0]; i++)
+    if (cards[i] >= 0) close(cards[i]);
+
+  return strdup(len ? buf : "unknown");
+}
+
+
+#define PCI_DEVICES "/sys/bus/pci/devices"
+
+/*
+ * function that reads attribute path of device dir to buf (last newline
+ * cut), unless deadline (monotonic ns) has passed
+ * returns 0 on success, -1 if it can't be read or there is no time left
+ */
+static int
+gpu_attr(int dir, const char *path, char *buf, size_t size, long long deadline)
+{
+  ssize_t n;
+  if (monotonic_ns() > deadline || (n = io_read_at(dir, path, buf, size)) <= 0)
+    return -1;
+  if (buf[n - 1] == '\n') buf[n - 1] = '\0';
+  return 0;
+}
+
+/*
+ * function that appends ", busy N%, clock, VRAM used / total"
+ * of amdgpu device dir to buf, clock is the active level of pp_dpm_sclk
+ * ("1: 1800Mhz *")
+ */
+static size_t
+amdgpu_stats(int dir, char *buf, size_t size, long long deadline)
+{
+  char val[512], a[32], b[32];
+  size_t len = 0;
+
+  if (gpu_attr(dir, "gpu_busy_percent", val, sizeof val, deadline) == 0)
+    len += snprintf(buf + len, size - len, ", busy %s%%", val);
+  if (len < size && gpu_attr(dir, "pp_dpm_sclk", val, sizeof val,
+                             deadline) == 0) {
+    /* levels are rows, the active one ends with '*' */
+    for (char *row = val, *end; *row; row = end) {
+      end = row + strcspn(row, "\n");
+      char *mhz = strchr(row, ':');
+      if (mhz && memchr(row, '*', end - row)) {
+        len += snprintf(buf + len, size - len, ", %ld MHz",
+                        strtol(mhz + 1, NULL, 10));
+        break;
+      }
+      if (*end) end++;
+    }
+  }
+
+  long long used, total;
+  if (len < size &&
+      gpu_attr(dir, "mem_info_vram_used", val, sizeof val, deadline) == 0 &&
+      (used = strtoll(val, NULL, 10)) >= 0 &&
+      gpu_attr(dir, "mem_info_vram_total", val, sizeof val, deadline) == 0 &&
+      (total = strtoll(val, NULL, 10)) > 0)
+    len += snprintf(buf + len, size - len, ", VRAM %s / %s",
+                    format_kib(a, sizeof a, used / 1024),
+                    format_kib(b, sizeof b, total / 1024));
+  return len;
+}
+
+/*
+ * function that appends ", actual / max MHz" of Intel device dir to buf,
+ * i915 has them on drm/cardN, xe per GT (first one)
+ */
+static size_t
+intel_stats(int dir, int card, const char *driver, char *buf, size_t size,
+            long long deadline)
+{
+  char cur_path[64], max_path[64], cur[32], max[32];
+
+  if (!strcmp(driver, "xe")) {
+    strcpy(cur_path, "tile0/gt0/freq0/act_freq");
+    strcpy(max_path, "tile0/gt0/freq0/max_freq");
+  } else {
+    snprintf(cur_path, sizeof cur_path, "drm/card%d/gt_act_freq_mhz", card);
+    snprintf(max_path, sizeof max_path, "drm/card%d/gt_max_freq_mhz", card);
+  }
+  if (gpu_attr(dir, cur_path, cur, sizeof cur, deadline) != 0)
+    return 0;
+  if (gpu_attr(dir, max_path, max, sizeof max, deadline) != 0)
+    return snprintf(buf, size, ", %s MHz", cur);
+  return snprintf(buf, size, ", %s / %s MHz", cur, max);
+}
+
+/*
+ * function that returns row per display class PCI device:
+ * "cardN driver, busy, clock, VRAM" from sysfs of its driver
+ * (amdgpu, i915, xe), attributes are read relative to the device
+ * directory within gpu_stats_ms, runtime suspended device
+ * is "suspended", reading attributes would power it up
+ */
+char *
+get_gpu_stats(void)
+{
+  char buf[2048] = "";
+  size_t len = 0;
+
+  io_dir *d = io_opendir(PCI_DEVICES);
+  const char *bdf;
+  if (!d) return strdup("unknown");
+
+  while ((bdf = io_readdir(d)) && len < sizeof buf - 1) {
+    char path[512], val[256], driver[64] = "";
+    if (bdf[0] == '.') continue;
+
+    snprintf(path, sizeof path, PCI_DEVICES "/%s", bdf);
+    int dir = io_open_dir(AT_FDCWD, path);
+    if (dir < 0) continue;
+    long long deadline = monotonic_ns() + gpu_stats_ms * 1000000LL;
+    /* 0x03xxxx is display controller */
+    if (io_read_at(dir, "class", val, sizeof val) <= 0 ||
+        strncmp(val, "0x03", 4) != 0) {
+      io_close_dir(dir);
+      continue;
+    }
+
+    ssize_t n = io_readlink_at(dir, "driver", path, sizeof path - 1);
+    if (n > 0) {
+      path[n] = '\0';
+      const char *name = strrchr(path, '/');
+      snprintf(driver, sizeof driver, "%.63s", name ? name + 1 : path);
+    }
+
+    /* cardN is in drm/ of device */
+    int card = -1;
+    snprintf(path, sizeof path, PCI_DEVICES "/%s/drm", bdf);
+    io_dir *drm = io_opendir(path);
+    const char *entry;
+    while (drm && (entry = io_readdir(drm)))
+      if (sscanf(entry, "card%d", &card) == 1 && !strchr(entry, '-'))
+        break;
+    io_closedir(drm);
+
+    if (card >= 0)
+      len += snprintf(buf + len, sizeof buf - len, "%scard%d %s",
+                      len ? "\n" : "", card, driver[0] ? driver : "?");
+    else
+      len += snprintf(buf + len, sizeof buf - len, "%s%s %s",
+                      len ? "\n" : "", bdf, driver[0] ? driver : "no driver");
+
+    if (len < sizeof buf &&
+        io_read_at(dir, "power/runtime_status", val, sizeof val) > 0 &&
+        !strncmp(val, "suspend", 7)) {
+      len += snprintf(buf + len, sizeof buf - len, ", suspended");
+    } else if (len < sizeof buf && !strcmp(driver, "amdgpu")) {
+      len += amdgpu_stats(dir, buf + len, sizeof buf - len, deadline);
+    } else if (len < sizeof buf &&
+               (!strcmp(driver, "i915") || !strcmp(driver, "xe"))) {
+      len += intel_stats(dir, card, driver, buf + len, sizeof buf - len,
+                         deadline);
+    }
+    if (len < sizeof buf && monotonic_ns() > deadline)
+      len += snprintf(buf + len, sizeof buf - len, ", timeout");
+    io_close_dir(dir);
+  }
+  io_closedir(d);
+
+  return strdup(len ? buf : "unknown");
+}
+
+
+/*
+ * function that returns "processes (threads, running, blocked)",
+ * threads from /proc/loadavg, running and blocked from /proc/stat
+ */
+char *
+get_processes(void)
+{
+  long procs = list_pids(NULL);
+  long threads = -1, running = -1, blocked = -1;
+  char line[256], buf[128];
+
+  FILE *f = io_fopen("/proc/loadavg");
+  if (f) {
+    if (fscanf(f, "%*s %*s %*s %*d/%ld", &threads) != 1) threads = -1;
+    fclose(f);
+  }
+
+  /* procs_* are last lines, cpu lines before them are skipped */
+  if ((f = io_fopen("/proc/stat"))) {
+    while (fgets(line, sizeof line, f)) {
+      if (!strncmp(line, "procs_running ", 14))
+        running = strtol(line + 14, NULL, 10);
+      else if (!strncmp(line, "procs_blocked ", 14))
+        blocked = strtol(line + 14, NULL, 10);
+    }
+    fclose(f);
+  }
+
+  if (procs < 0) return strdup("unknown");
+  int len = snprintf(buf, sizeof buf, "%ld", procs);
+  if (threads >= 0 && running >= 0 && blocked >= 0)
+    snprintf(buf + len, sizeof buf - len,
+             " (%ld threads, %ld running, %ld blocked)",
+             threads, running, blocked);
+  return strdup(buf);
+}
+
+
+/* set of user names (open addressing), names are UT_NAMESIZE bounded */
+typedef struct
+{
+  const char **slots;
+  size_t size;     /* power of 2 */
+  long count;
+} name_set;
+
+static uint32_t
+name_hash(const char *name)
+{
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < UT_NAMESIZE && name[i]; i++) {
+    h ^= (unsigned char)name[i];
+    h *= 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+/*
+ * function that adds name (it must live as long as the set),
+ * table grows to keep it at most half full
+ * returns -1 if there is no memory
+ */
+static int
+name_set_add(name_set *s, const char *name)
+{
+  if ((size_t)(s->count + 1) * 2 > s->size) {
+    name_set n = { calloc(s->size ? s->size * 2 : 64, sizeof *n.slots),
+                   s->size ? s->size * 2 : 64, 0 };
+    if (!n.slots) return -1;
+    for (size_t i = 0; i < s->size; i++)
+      if (s->slots[i]) name_set_add(&n, s->slots[i]);
+    free(s->slots);
+    *s = n;
+  }
+
+  size_t mask = s->size - 1;
+  for (size_t i = name_hash(name) & mask; ; i = (i + 1) & mask) {
+    if (!s->slots[i]) {
+      s->slots[i] = name;
+      s->count++;
+      return 0;
+    }
+    if (!strncmp(s->slots[i], name, UT_NAMESIZE)) return 0;
+  }
+}
+
+/*
+ * function that counts sessions of logind (where there is no utmp),
+ * /run/systemd/sessions/<id> has USER= and CLASS= lines,
+ * names are kept in *names (freed by caller)
+ * returns count of sessions, -1 if there is no logind
+ */
+static long
+logind_sessions(name_set *users, char ***names, size_t *names_count)
+{
+  io_dir *d = io_opendir("/run/systemd/sessions");
+  int dir = io_open_dir(AT_FDCWD, "/run/systemd/sessions");
+  const char *id;
+  long sessions = 0;
+
+  while (d && dir >= 0 && (id = io_readdir(d))) {
+    char buf[4096], *user, *class;
+    size_t len = strlen(id);
+    if (id[0] == '.' || (len > 4 && !strcmp(id + len - 4, ".ref")) ||
+        io_read_at(dir, id, buf, sizeof buf) <= 0 ||
+        !(user = strstr(buf, "\nUSER=")))
+      continue;
+    /* greeters and user managers aren't logins */
+    if ((class = strstr(buf, "\nCLASS=")) && strncmp(class + 7, "user", 4))
+      continue;
+
+    user += 6;
+    user[strcspn(user, "\n")] = '\0';
+    char **n = realloc(*names, (*names_count + 1) * sizeof *n);
+    if (!n || !(n[*names_count] = strdup(user))) {
+      if (n) *names = n;
+      break;
+    }
+    *names = n;
+    name_set_add(users, n[(*names_count)++]);
+    sessions++;
+  }
+  if (dir >= 0) io_close_dir(dir);
+  io_closedir(d);
+  return d && dir >= 0 ? sessions : -1;
+}
+
+/*
+ * function that returns "N users, M sessions": USER_PROCESS records of
+ * utmp (mmap-ed, one pass over fixed-size records), distinct names,
+ * /run/systemd/sessions where there is no utmp
+ */
+char *
+get_users(void)
+{
+  name_set users = {0};
+  char **names = NULL, buf[64];
+  size_t len = 0, names_count = 0;
+  long sessions = 0;
+
+  const struct utmp *ut = io_map("/var/run/utmp", &len);
+  if (ut) {
+    for (size_t i = 0; i < len / sizeof *ut; i++) {
+      if (ut[i].ut_type != USER_PROCESS || !ut[i].ut_user[0]) continue;
+      sessions++;
+      name_set_add(&users, ut[i].ut_user);
+    }
+  } else {
+    sessions = logind_sessions(&users, &names, &names_count);
+  }
+
+  if (sessions < 0)
+    snprintf(buf, sizeof buf, "unknown");
+  else
+    snprintf(buf, sizeof buf, "%ld user%s, %ld session%s",
+             users.count, users.count == 1 ? "" : "s",
+             sessions, sessions == 1 ? "" : "s");
+
+  io_unmap(ut, len);
+  free(users.slots);
+  for (size_t i = 0; i < names_count; i++) free(names[i]);
+  free(names);
+  return strdup(buf);
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+/* cpuid feature bit */
+typedef struct {
+  const char *name;
+  unsigned leaf, sub;
+  int reg, bit;
+} isa_bit;
+
+static const isa_bit isa_bits[] = {
+  /* x86-64-v2 */
+  { "sse3",        1, 0, ECX, 0 },  { "ssse3",       1, 0, ECX, 9 },
+  { "cx16",        1, 0, ECX, 13 }, { "sse4_1",      1, 0, ECX, 19 },
+  { "sse4_2",      1, 0, ECX, 20 }, { "popcnt",      1, 0, ECX, 23 },
+  { "lahf_lm",     0x80000001, 0, ECX, 0 },
+  /* x86-64-v3 */
+  { "fma",         1, 0, ECX, 12 }, { "movbe",       1, 0, ECX, 22 },
+  { "osxsave",     1, 0, ECX, 27 }, { "avx",         1, 0, ECX, 28 },
+  { "f16c",        1, 0, ECX, 29 }, { "bmi1",        7, 0, EBX, 3 },
+  { "avx2",        7, 0, EBX, 5 },  { "bmi2",        7, 0, EBX, 8 },
+  { "abm",         0x80000001, 0, ECX, 5 },
+  /* x86-64-v4 */
+  { "avx512f",     7, 0, EBX, 16 }, { "avx512dq",    7, 0, EBX, 17 },
+  { "avx512cd",    7, 0, EBX, 28 }, { "avx512bw",    7, 0, EBX, 30 },
+  { "avx512vl",    7, 0, EBX, 31 },
+  /* others */
+  { "aes",         1, 0, ECX, 25 }, { "rdrand",      1, 0, ECX, 30 },
+  { "rdseed",      7, 0, EBX, 18 }, { "adx",         7, 0, EBX, 19 },
+  { "sha_ni",      7, 0, EBX, 29 }, { "gfni",        7, 0, ECX, 8 },
+  { "vaes",        7, 0, ECX, 9 },  { "vpclmulqdq",  7, 0, ECX, 10 },
+  { "avx512_vnni", 7, 0, ECX, 11 }, { "amx_bf16",    7, 0, EDX, 22 },
+  { "amx_tile",    7, 0, EDX, 24 }, { "amx_int8",    7, 0, EDX, 25 },
+  { "avx_vnni",    7, 1, EAX, 4 },  { "avx512_bf16", 7, 1, EAX, 5 },
+  { "avx10",       7, 1, EDX, 19 },
+};
+
+static const char *isa_levels[][16] = {
+  { "sse3", "ssse3", "cx16", "sse4_1", "sse4_2", "popcnt", "lahf_lm", NULL },
+  { "fma", "movbe", "osxsave", "avx", "f16c", "bmi1", "avx2", "bmi2", "abm",
+    NULL },
+  { "avx512f", "avx512dq", "avx512cd", "avx512bw", "avx512vl", NULL },
+};
+
+/* hypervisor vendor leaf signatures */
+static const char *hypervisors[][2] = {
+  { "KVMKVMKVM",    "KVM" },
+  { "Microsoft Hv", "Hyper-V" },
+  { "VMwareVMware", "VMware" },
+  { "XenVMMXenVMM", "Xen" },
+  { "TCGTCGTCGTCG", "QEMU" },
+  { "VBoxVBoxVBox", "VirtualBox" },
+  { " lrpepyh  vr", "Parallels" },
+  { "bhyve bhyve ", "bhyve" },
+  { "ACRNACRNACRN", "ACRN" },
+  { "QNXQVMBSQG",   "QNX" },
+  { "Apple VZ",     "Apple" },
+};
+
+/*
+ * function that returns cpuid bit by name, -1 if it is unknown
+ */
+static int
+isa_has(const char *name)
+{
+  unsigned r[4];
+  for (size_t i = 0; i < sizeof isa_bits / sizeof isa_bits[0]; i++) {
+    if (strcmp(isa_bits[i].name, name)) continue;
+    cpuid(isa_bits[i].leaf, isa_bits[i].sub, r);
+    return (r[isa_bits[i].reg] >> isa_bits[i].bit) & 1;
+  }
+  return -1;
+}
+
+/*
+ * function that returns vendor of hypervisor, NULL on bare metal
+ */
+static const char *
+hypervisor(char *sig, size_t size)
+{
+  unsigned r[4];
+  cpuid(1, 0, r);
+  if (!(r[ECX] >> 31 & 1)) return NULL;
+
+  cpuid(0x40000000, 0, r);
+  char id[13];
+  memcpy(id, &r[EBX], 4);
+  memcpy(id + 4, &r[ECX], 4);
+  memcpy(id + 8, &r[EDX], 4);
+  id[12] = '\0';
+  for (size_t i = 0; i < sizeof hypervisors / sizeof hypervisors[0]; i++)
+    if (!strncmp(id, hypervisors[i][0], strlen(hypervisors[i][0])))
+      return hypervisors[i][1];
+  snprintf(sig, size, "%s", id[0] ? id : "unknown");
+  return sig;
+}
+
+/*
+ * function that returns x86-64 level: 1-4, features of level
+ * and OS support of ymm/zmm state (XCR0)
+ */
+static int
+isa_level(void)
+{
+  unsigned r[4];
+  unsigned long long xcr0 = 0;
+  int level = 1;
+
+  cpuid(1, 0, r);
+  if (r[ECX] >> 27 & 1 && io_value("xgetbv", &xcr0, sizeof xcr0) != 0) {
+    unsigned lo, hi;
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    xcr0 = (unsigned long long)hi << 32 | lo;
+    io_record("xgetbv", &xcr0, sizeof xcr0);
+  }
+
+  for (size_t l = 0; l < sizeof isa_levels / sizeof isa_levels[0]; l++) {
+    for (const char **f = isa_levels[l]; *f; f++)
+      if (isa_has(*f) != 1) return level;
+    if (l == 1 && (xcr0 & 0x6) != 0x6) return level;    /* xmm, ymm */
+    if (l == 2 && (xcr0 & 0xe0) != 0xe0) return level;  /* opmask, zmm */
+    level++;
+  }
+  return level;
+}
+
+/*
+ * function that returns "x86-64-vN, extensions, hypervisor"
+ * from cpuid, extensions are isa_extensions, the CPU has
+ */
+char *
+get_isa(void)
+{
+  char buf[512], sig[16];
+  int len = snprintf(buf, sizeof buf, "x86-64-v%d", isa_level());
+  const char *sep = ", ";
+
+  for (const char **e = isa_extensions; *e && len < (int)sizeof buf; e++) {
+    if (isa_has(*e) != 1) continue;
+    len += snprintf(buf + len, sizeof buf - len, "%s%s", sep, *e);
+    sep = " ";
+  }
+
+  const char *hv = hypervisor(sig, sizeof sig);
+  if (hv && len < (int)sizeof buf)
+    snprintf(buf + len, sizeof buf - len, ", %s guest", hv);
+  return strdup(buf);
+}
+
+#elif defined(__aarch64__)
+/* AT_HWCAP/AT_HWCAP2 bit */
+typedef struct {
+  const char *name;
+  unsigned long type;
+  int bit;
+} isa_bit;
+
+static const isa_bit isa_bits[] = {
+  { "asimd",   AT_HWCAP, 1 },   { "aes",     AT_HWCAP, 3 },
+  { "sha1",    AT_HWCAP, 5 },   { "sha2",    AT_HWCAP, 6 },
+  { "crc32",   AT_HWCAP, 7 },   { "atomics", AT_HWCAP, 8 },
+  { "asimddp", AT_HWCAP, 20 },  { "sha3",    AT_HWCAP, 17 },
+  { "sha512",  AT_HWCAP, 21 },  { "sve",     AT_HWCAP, 22 },
+  { "sve2",    AT_HWCAP2, 1 },  { "i8mm",    AT_HWCAP2, 13 },
+  { "bf16",    AT_HWCAP2, 14 }, { "sme",     AT_HWCAP2, 23 },
+};
+
+/*
+ * function that returns "aarch64, extensions" from AT_HWCAP/AT_HWCAP2,
+ * extensions are isa_extensions, the CPU has
+ */
+char *
+get_isa(void)
+{
+  char buf[512];
+  unsigned long hwcap = getauxval(AT_HWCAP), hwcap2 = getauxval(AT_HWCAP2);
+  int len = snprintf(buf, sizeof buf, "aarch64");
+  const char *sep = ", ";
+
+  for (const char **e = isa_extensions; *e && len < (int)sizeof buf; e++) {
+    for (size_t i = 0; i < sizeof isa_bits / sizeof isa_bits[0]; i++) {
+      unsigned long cap = isa_bits[i].type == AT_HWCAP ? hwcap : hwcap2;
+      if (strcmp(isa_bits[i].name, *e) || !(cap >> isa_bits[i].bit & 1))
+        continue;
+      len += snprintf(buf + len, sizeof buf - len, "%s%s", sep, *e);
+      sep = " ";
+    }
+  }
+  return strdup(buf);
+}
+
+#else
+char *
+get_isa(void)
+{
+  return strdup("unknown");
+}
+#endif
+
+#if !defined(__x86_64__) && !defined(__i386__)
+/* there is no cpuid, DMI tells if it's VM */
+static const char *
+hypervisor(char *sig, size_t size)
+{
+  (void)sig;
+  (void)size;
+  return NULL;
+}
+#endif
+
+/* DMI sys_vendor or product_name prefixes of VMs */
+static const char *virt_dmi[][2] = {
+  { "QEMU",             "QEMU" },
+  { "KVM",              "KVM" },
+  { "Amazon EC2",       "Amazon EC2" },
+  { "Google",           "Google Compute Engine" },
+  { "OpenStack",        "OpenStack" },
+  { "VMware",           "VMware" },
+  { "innotek GmbH",     "VirtualBox" },
+  { "VirtualBox",       "VirtualBox" },
+  { "Xen",              "Xen" },
+  { "Virtual Machine",  "Hyper-V" },
+  { "Parallels",        "Parallels" },
+  { "BHYVE",            "bhyve" },
+  { "Bochs",            "Bochs" },
+  { "Cloud Hypervisor", "Cloud Hypervisor" },
+  { "Firecracker",      "Firecracker" },
+};
+
+/*
+ * container markers, looked for in container= of /proc/1/environ,
+ * /proc/1/cgroup and mounts, that engines make (see container())
+ */
+static const char *containers[][2] = {
+  { "kubepods",           "Kubernetes" },
+  { "kubernetes.io",      "Kubernetes" },
+  { "kubelet",            "Kubernetes" },
+  { "libpod",             "Podman" },
+  { "podman",             "Podman" },
+  { "containers/storage", "Podman" },
+  { "docker",             "Docker" },
+  { "lxcfs",              "LXC" },
+  { "lxc",                "LXC" },
+  { "systemd-nspawn",     "systemd-nspawn" },
+};
+
+/*
+ * function that returns container engine, which marker is in s, or NULL
+ */
+static const char *
+container_marker(const char *s)
+{
+  for (size_t i = 0; i < sizeof containers / sizeof containers[0]; i++)
+    if (strstr(s, containers[i][0])) return containers[i][1];
+  return NULL;
+}
+
+/*
+ * function that returns container engine of fetcha, NULL if it isn't
+ * in container, checks from cheap to expensive:
+ * - container= of init (set by nspawn, lxc, podman, readable by root)
+ * - cgroup of init (cgroup v1, v2 without namespace)
+ * - /run/.containerenv (podman), /.dockerenv
+ * - mounts, that engines bind: root, /etc/hostname, /etc/hosts,
+ *   /etc/resolv.conf, secrets and lxcfs files in /proc
+ */
+static const char *
+container(char *buf, size_t size)
+{
+  char env[4096];
+  ssize_t n = io_read_at(AT_FDCWD, "/proc/1/environ", env, sizeof env);
+  for (char *p = env; n > 0 && p < env + n; p += strlen(p) + 1) {
+    if (strncmp(p, "container=", 10) != 0 || !p[10]) continue;
+    const char *engine = container_marker(p + 10);
+    if (engine) return engine;
+    snprintf(buf, size, "%s", p + 10);
+    return buf;
+  }
+
+  char cg[4096];
+  const char *engine = NULL;
+  if (io_read_at(AT_FDCWD, "/proc/1/cgroup", cg, sizeof cg) > 0 &&
+      (engine = container_marker(cg)))
+    return engine;
+
+  if (io_access("/run/.containerenv") == 0) return "Podman";
+  if (io_access("/.dockerenv") == 0) return "Docker";
+
+  FILE *f = io_fopen("/proc/self/mountinfo");
+  char line[1024], mnt[256];
+  static const char *targets[] = {
+    "/", "/etc/hostname", "/etc/hosts", "/etc/resolv.conf", NULL
+  };
+  while (f && !engine && fgets(line, sizeof line, f)) {
+    if (sscanf(line, "%*s %*s %*s %*s %255s", mnt) != 1) continue;
+    bool target = !strncmp(mnt, "/run/secrets", 12) ||
+                  !strncmp(mnt, "/var/run/secrets", 16) ||
+                  !strncmp(mnt, "/proc/", 6);
+    for (const char **t = targets; !target && *t; t++)
+      target = !strcmp(mnt, *t);
+    if (target) engine = container_marker(line);
+  }
+  if (f) fclose(f);
+  return engine;
+}
+
+/*
+ * function that returns "container on VM", "VM", "container" or
+ * "bare metal", without subprocesses: VM is vendor of cpuid hypervisor
+ * leaf, DMI names it better (cloud), KVM without DMI is a microVM
+ * (Firecracker), WSL is told by kernel release
+ */
+char *
+get_virt(void)
+{
+  char sig[16], engine_buf[64], buf[128];
+  const char *vm = hypervisor(sig, sizeof sig);
+  const char *vendor = dmi(DMI_VENDOR), *product = dmi(DMI_PRODUCT);
+  struct utsname u;
+
+#if defined(__x86_64__) || defined(__i386__)
+  bool guest = vm != NULL;   /* DMI of bare metal cloud hosts is the same */
+#else
+  bool guest = true;
+#endif
+  for (size_t i = 0; guest && i < sizeof virt_dmi / sizeof virt_dmi[0]; i++) {
+    size_t len = strlen(virt_dmi[i][0]);
+    if ((vendor && !strncmp(vendor, virt_dmi[i][0], len)) ||
+        (product && !strncmp(product, virt_dmi[i][0], len))) {
+      vm = virt_dmi[i][1];
+      break;
+    }
+  }
+  if (vm && !strcmp(vm, "KVM") && !vendor && !product)
+    vm = "KVM microVM";
+  if (io_uname(&u) == 0 &&
+      (strstr(u.release, "microsoft") || strstr(u.release, "Microsoft")))
+    vm = "WSL";
+
+  const char *engine = container(engine_buf, sizeof engine_buf);
+  if (engine && vm)
+    snprintf(buf, sizeof buf, "%s on %s", engine, vm);
+  else
+    snprintf(buf, sizeof buf, "%s", engine ? engine : vm ? vm : "bare metal");
+  return strdup(buf);
+}
@@ -1,12 +1,47 @@
 #ifndef MODULES_H
 #define MODULES_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
 
 typedef  char*(*info_func_t)(void);
 
+/* fields of /etc/os-release */
+struct os_release {
+  char id[64];
+  char id_like[256];
+  char pretty_name[256];
+};
+
+/* info_item.flags, how long result of module stays valid (fetcha --daemon) */
+enum {
+  ITEM_LIVE   = 1 << 0, /* changes all the time, run for every frame */
+  ITEM_ENV    = 1 << 1, /* depends on environment of client (daemon_env) */
+  ITEM_SHARED = 1 << 2, /* slow, runs once for processes started together */
+};
+
+/* parents of fetcha, see ancestry() */
+#define ANCESTRY_MAX 16
+
+struct proc {
+  pid_t pid;
+  char comm[16];
+};
+
+struct ancestry {
+  int count;
+  struct proc procs[ANCESTRY_MAX]; /* parent of fetcha first */
+  int shell;                       /* index of nearest shell, -1 */
+  int terminal;                    /* index of terminal emulator, -1 */
+  char shell_exe[256];             /* path of shell binary */
+};
+
 typedef struct {
   const char *label;
   info_func_t func;
+  int rows;       /* most rows module prints, others are cut, 0 means 1 */
+  int flags;      /* ITEM_*, 0 - result never changes */
 } info_item;
 
 
@@ -15,13 +50,42 @@ char *get_os(void);
 char *get_host(void);
 char *get_kernel(void);
 char *get_uptime(void);
+char *get_boot(void);
 char *get_memory(void);
 char *get_cpus(void);
 char *get_gpus(void);
+char *get_gpu_stats(void);
 char *get_wm(void);
 char *get_shell(void);
 char *get_terminal(void);
 char *get_editor(void);
+char *get_cpu_load(void);
+char *get_display(void);
+char *get_processes(void);
+char *get_isa(void);
+char *get_virt(void);
+char *get_users(void);
+
+int state_path(const char *name, char *buf, size_t size);
+const struct os_release *os_release(void);
+const struct ancestry *ancestry(void);
+void ancestry_from(pid_t pid);
+
+/* module options, defined in config.h */
+extern const bool cpu_load_psi;
+extern const bool cpu_load_numa;
+extern const bool cpu_load_percore;
+extern const int  cpu_load_sample_ms;
+extern const int  cpu_load_max_age;
+extern const bool container_view;
+extern const bool memory_detail;
+extern const int  memory_top;
+extern const int  memory_top_threads;
+extern const bool display_ioctl;
+extern const int  gpu_stats_ms;
+extern const char *isa_extensions[];
+extern const bool terminal_query;
+extern const int  terminal_query_ms;
 
 
 #endif